@@ -0,0 +1,521 @@
+/*
+  ==============================================================================
+
+    BlockIIR.h
+    Biquad sections in transposed direct form II, with a time-parallel
+    block state-space kernel for long single-channel cascades.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+/** Normalised biquad coefficients (a0 == 1), laid out like the coefficient
+    array of juce::dsp::IIR::Coefficients for a second order section.
+*/
+struct BiquadCoefficients
+{
+  float b0{1}, b1{0}, b2{0}, a1{0}, a2{0};
+
+  bool operator== (const BiquadCoefficients& other) const noexcept
+  {
+    return b0 == other.b0 && b1 == other.b1 && b2 == other.b2
+        && a1 == other.a1 && a2 == other.a2;
+  }
+  bool operator!= (const BiquadCoefficients& other) const noexcept { return ! (*this == other); }
+
+  /** True when the numerator and denominator cancel exactly, e.g. a peak at 0 dB. */
+  bool isIdentity() const noexcept
+  {
+    return b0 == 1.f && b1 == a1 && b2 == a2;
+  }
+};
+
+/** The same coefficients in double precision, as the designers compute them.
+    BiquadCoefficients are rounded from these; the sections that
+    needsDoublePrecision() picks run on them unrounded, because rounding a1
+    and a2 to float moves poles close to z = 1 by a sizeable fraction of
+    their distance from it.
+*/
+struct PreciseBiquadCoefficients
+{
+  double b0{1}, b1{0}, b2{0}, a1{0}, a2{0};
+
+  bool operator== (const PreciseBiquadCoefficients& other) const noexcept
+  {
+    return b0 == other.b0 && b1 == other.b1 && b2 == other.b2
+        && a1 == other.a1 && a2 == other.a2;
+  }
+  bool operator!= (const PreciseBiquadCoefficients& other) const noexcept { return ! (*this == other); }
+
+  BiquadCoefficients toFloat() const noexcept
+  {
+    return { (float) b0, (float) b1, (float) b2, (float) a1, (float) a2 };
+  }
+};
+
+/** The two state variables of a transposed direct form II section. Both the
+    scalar and the block kernel use this representation, so a section can be
+    moved between them from one block to the next without a discontinuity.
+*/
+struct BiquadState
+{
+  float s1{0}, s2{0};
+
+  void reset() noexcept { s1 = s2 = 0; }
+};
+
+/** The same state in double precision, for the sections that
+    needsDoublePrecision() picks. Converting between the two moves a section
+    from one precision to the other without a discontinuity.
+*/
+struct PreciseBiquadState
+{
+  double s1{0}, s2{0};
+
+  void reset() noexcept { s1 = s2 = 0; }
+};
+
+/** The recursion amplifies rounding in a section's state roughly in
+    proportion to 1 / A(1), where A(1) = 1 + a1 + a2 is the product of the
+    poles' distances from z = 1. Low HP and LP cut-offs and low peaks, more so
+    at high sample rates, push it towards zero: in single precision a 30 Hz
+    stage at 96 kHz (A(1) = 4e-6) nulls at about -72 dB against a double
+    precision reference, where a 1 kHz stage at 48 kHz nulls at -127 dB.
+    Sections that would null above about -100 dB run in double precision.
+*/
+inline bool needsDoublePrecision (const BiquadCoefficients& c) noexcept
+{
+  constexpr double minPoleDistance = 1.0e-3;
+  return 1.0 + (double) c.a1 + (double) c.a2 < minPoleDistance;
+}
+
+/** Precomputed block matrices of one section, for the block size L of the
+    kernel that designed them. values points into a BlockSectionArray made
+    for that L and holds the columns of T, the two columns of G, the two rows
+    of K and then P, L x L + 4 L + 4 floats in all; a 4-wide kernel needs a
+    ninth of the storage of a 16-wide one. Copying a BlockSectionMatrices
+    copies the reference, not the values.
+*/
+struct BlockSectionMatrices
+{
+  static constexpr size_t maxBlockSize = 16;
+
+  static constexpr size_t getNumValues (size_t blockSize) noexcept
+  {
+    return blockSize * blockSize + 4 * blockSize + 4;
+  }
+
+  float* values = nullptr;
+  BiquadCoefficients coefficients;
+};
+
+/** The block matrices of a fixed number of sections for one block size, in
+    one allocation made up front. Every section starts on a cache line, so
+    the kernels can load the columns as aligned registers.
+*/
+class BlockSectionArray
+{
+public:
+  BlockSectionArray (size_t numSections, size_t blockSize)
+    : valuesPerSection (getNumLines (blockSize) * valuesPerLine),
+      lines (numSections * getNumLines (blockSize)),
+      sections (numSections)
+  {
+    for (size_t i = 0; i < numSections; ++i)
+      sections[i].values = lines[i * getNumLines (blockSize)].values;
+  }
+
+  size_t size() const noexcept { return sections.size(); }
+
+  BlockSectionMatrices& operator[] (size_t index) noexcept { return sections[index]; }
+  const BlockSectionMatrices& operator[] (size_t index) const noexcept { return sections[index]; }
+
+  /** Copies the matrices of a section of the same block size into this
+      array's section at index.
+  */
+  void assign (size_t index, const BlockSectionMatrices& source) noexcept
+  {
+    std::copy (source.values, source.values + valuesPerSection, sections[index].values);
+    sections[index].coefficients = source.coefficients;
+  }
+
+private:
+  static constexpr size_t valuesPerLine = 16;
+
+  struct alignas (64) CacheLine
+  {
+    float values[valuesPerLine];
+  };
+
+  static size_t getNumLines (size_t blockSize) noexcept
+  {
+    return (BlockSectionMatrices::getNumValues (blockSize) + valuesPerLine - 1) / valuesPerLine;
+  }
+
+  size_t valuesPerSection;
+  std::vector<CacheLine> lines;
+  std::vector<BlockSectionMatrices> sections;
+};
+
+/** The pre-filter and RLB high-pass of the ITU-R BS.1770 K-weighting. Both
+    refer to matrices kept in a BlockSectionArray.
+*/
+struct KWeightingMatrices
+{
+  BlockSectionMatrices shelf, highPass;
+};
+
+/** One K-weighted meter; energy sums the squared weighted samples until the
+    caller takes it.
+*/
+struct KWeightingState
+{
+  BiquadState shelf, highPass;
+  double energy = 0;
+
+  void reset() noexcept { shelf.reset(); highPass.reset(); energy = 0; }
+};
+
+/** Loudness metering and a makeup gain ramp that ride along with a section's
+    pass over the samples, instead of sweeping the buffer again.
+*/
+struct LoudnessTap
+{
+  const KWeightingMatrices* weighting = nullptr;
+  KWeightingState* input = nullptr;     // metered before the section
+  KWeightingState* output = nullptr;    // metered after it, before the gain
+  float gain = 1.f, gainStep = 0.f;     // applied to the output, advanced per sample
+};
+
+//==============================================================================
+/** Processes one biquad section L = SIMDType::SIMDNumElements samples at a time.
+
+    Over a block of L samples the section is a linear map of the block input u
+    and the incoming state s:
+
+        y  = T u + G s          (T: L x L lower triangular Toeplitz, G: L x 2)
+        s' = P s + K u          (P = A^L: 2 x 2,  K: 2 x L)
+
+    y is evaluated with L + 2 vector multiply-adds and does not feed back, so
+    the only serial dependency between blocks is the 2 x 2 state update. All
+    matrices are found by running the scalar recursion on unit inputs.
+    Remainders shorter than L run through the scalar recursion, which is the
+    same as juce::dsp::IIR::Filter for a second order section.
+
+    SIMDType is expected to behave like juce::dsp::SIMDRegister<float>.
+*/
+template <typename SIMDType>
+struct BlockStateSpaceKernel
+{
+  static constexpr size_t blockSize = SIMDType::SIMDNumElements;
+
+  static_assert (blockSize >= 2 && blockSize <= BlockSectionMatrices::maxBlockSize, "unsupported block size");
+
+  // Where each matrix starts in BlockSectionMatrices::values; T starts at 0.
+  static constexpr size_t stateColumnsOffset = blockSize * blockSize;
+  static constexpr size_t k1Offset = stateColumnsOffset + 2 * blockSize;
+  static constexpr size_t k2Offset = k1Offset + blockSize;
+  static constexpr size_t pOffset = k2Offset + blockSize;
+
+  static_assert (pOffset + 4 == BlockSectionMatrices::getNumValues (blockSize), "the layout must fill the section");
+
+  static void design (const BiquadCoefficients& c, BlockSectionMatrices& m) noexcept
+  {
+    // Columns of T and K: impulse at position j, zero initial state.
+    for (size_t j = 0; j < blockSize; ++j)
+    {
+      BiquadState st;
+      for (size_t k = 0; k < blockSize; ++k)
+        m.values[j * blockSize + k] = step (c, st, k == j ? 1.f : 0.f);
+
+      m.values[k1Offset + j] = st.s1;
+      m.values[k2Offset + j] = st.s2;
+    }
+
+    // Columns of G and P: unit initial state, zero input.
+    for (size_t i = 0; i < 2; ++i)
+    {
+      BiquadState st { i == 0 ? 1.f : 0.f, i == 0 ? 0.f : 1.f };
+      for (size_t k = 0; k < blockSize; ++k)
+        m.values[stateColumnsOffset + i * blockSize + k] = step (c, st, 0.f);
+
+      m.values[pOffset + 2 * i] = st.s1;
+      m.values[pOffset + 2 * i + 1] = st.s2;
+    }
+
+    m.coefficients = c;
+  }
+
+  static void process (const BlockSectionMatrices& m, BiquadState& state,
+                       float* samples, size_t numSamples) noexcept
+  {
+    SIMDType inputColumns[blockSize];
+    for (size_t j = 0; j < blockSize; ++j)
+      inputColumns[j] = SIMDType::fromRawArray (m.values + j * blockSize);
+
+    const auto g1 = SIMDType::fromRawArray (m.values + stateColumnsOffset);
+    const auto g2 = SIMDType::fromRawArray (m.values + stateColumnsOffset + blockSize);
+    const auto* k1 = m.values + k1Offset;
+    const auto* k2 = m.values + k2Offset;
+    const auto* p = m.values + pOffset;
+
+    auto s1 = state.s1, s2 = state.s2;
+    size_t n = 0;
+
+    for (; n + blockSize <= numSamples; n += blockSize)
+    {
+      auto* u = samples + n;
+
+      auto y = g1 * SIMDType::expand (s1);
+      y = SIMDType::multiplyAdd (y, g2, SIMDType::expand (s2));
+
+      auto n1 = p[0] * s1 + p[2] * s2;
+      auto n2 = p[1] * s1 + p[3] * s2;
+
+      for (size_t j = 0; j < blockSize; ++j)
+      {
+        y = SIMDType::multiplyAdd (y, inputColumns[j], SIMDType::expand (u[j]));
+        n1 += k1[j] * u[j];
+        n2 += k2[j] * u[j];
+      }
+
+      // Every input of the block has been read, so y can go straight back.
+      y.copyToRawArray (u);
+
+      s1 = n1;
+      s2 = n2;
+    }
+
+    state.s1 = s1;
+    state.s2 = s2;
+    processScalar (m.coefficients, state, samples + n, numSamples - n);
+  }
+
+  /** process() with a LoudnessTap: the K-weighting sections run on the input
+      and output vectors while they are still in registers. tap.gain is left
+      where the ramp ended.
+  */
+  static void processMetered (const BlockSectionMatrices& m, BiquadState& state,
+                              float* samples, size_t numSamples, LoudnessTap& tap) noexcept
+  {
+    SIMDType inputColumns[blockSize];
+    for (size_t j = 0; j < blockSize; ++j)
+      inputColumns[j] = SIMDType::fromRawArray (m.values + j * blockSize);
+
+    const auto g1 = SIMDType::fromRawArray (m.values + stateColumnsOffset);
+    const auto g2 = SIMDType::fromRawArray (m.values + stateColumnsOffset + blockSize);
+    const auto* k1 = m.values + k1Offset;
+    const auto* k2 = m.values + k2Offset;
+    const auto* p = m.values + pOffset;
+
+    alignas (SIMDType) float weighted[blockSize], ramp[blockSize];
+    for (size_t k = 0; k < blockSize; ++k)
+      ramp[k] = tap.gainStep * (float) k;
+
+    const auto rampOffsets = SIMDType::fromRawArray (ramp);
+    auto inputEnergy = SIMDType::expand (0.f), outputEnergy = SIMDType::expand (0.f);
+    auto gain = tap.gain;
+    auto s1 = state.s1, s2 = state.s2;
+    size_t n = 0;
+
+    for (; n + blockSize <= numSamples; n += blockSize)
+    {
+      auto* u = samples + n;
+
+      if (tap.input != nullptr)
+        inputEnergy = accumulateWeighted (*tap.weighting, *tap.input, u, weighted, inputEnergy);
+
+      auto y = g1 * SIMDType::expand (s1);
+      y = SIMDType::multiplyAdd (y, g2, SIMDType::expand (s2));
+
+      auto n1 = p[0] * s1 + p[2] * s2;
+      auto n2 = p[1] * s1 + p[3] * s2;
+
+      for (size_t j = 0; j < blockSize; ++j)
+      {
+        y = SIMDType::multiplyAdd (y, inputColumns[j], SIMDType::expand (u[j]));
+        n1 += k1[j] * u[j];
+        n2 += k2[j] * u[j];
+      }
+
+      if (tap.output != nullptr)
+      {
+        y.copyToRawArray (u);
+        outputEnergy = accumulateWeighted (*tap.weighting, *tap.output, u, weighted, outputEnergy);
+      }
+
+      y = y * (SIMDType::expand (gain) + rampOffsets);
+      gain += tap.gainStep * (float) blockSize;
+
+      y.copyToRawArray (u);
+
+      s1 = n1;
+      s2 = n2;
+    }
+
+    state.s1 = s1;
+    state.s2 = s2;
+
+    auto inputTail = 0.f, outputTail = 0.f;
+
+    for (; n < numSamples; ++n)
+    {
+      if (tap.input != nullptr)
+        inputTail += square (stepWeighted (*tap.weighting, *tap.input, samples[n]));
+
+      const auto y = step (m.coefficients, state, samples[n]);
+
+      if (tap.output != nullptr)
+        outputTail += square (stepWeighted (*tap.weighting, *tap.output, y));
+
+      samples[n] = y * gain;
+      gain += tap.gainStep;
+    }
+
+    snapToZero (state.s1);
+    snapToZero (state.s2);
+
+    finishMeter (tap.input, inputEnergy.sum() + inputTail);
+    finishMeter (tap.output, outputEnergy.sum() + outputTail);
+    tap.gain = gain;
+  }
+
+  static void processScalar (const BiquadCoefficients& c, BiquadState& state,
+                             float* samples, size_t numSamples) noexcept
+  {
+    for (size_t i = 0; i < numSamples; ++i)
+      samples[i] = step (c, state, samples[i]);
+
+    snapToZero (state.s1);
+    snapToZero (state.s2);
+  }
+
+  /** The scalar recursion in double precision, on the coefficients as the
+      designer computed them. With a tap, it meters and applies the gain like
+      processMetered().
+  */
+  static void processPrecise (const PreciseBiquadCoefficients& c, PreciseBiquadState& state,
+                              float* samples, size_t numSamples, LoudnessTap* tap) noexcept
+  {
+    const auto b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+    auto s1 = state.s1, s2 = state.s2;
+
+    auto next = [&] (double in)
+    {
+      const auto out = b0 * in + s1;
+      s1 = b1 * in - a1 * out + s2;
+      s2 = b2 * in - a2 * out;
+      return out;
+    };
+
+    if (tap == nullptr)
+    {
+      for (size_t i = 0; i < numSamples; ++i)
+        samples[i] = (float) next (samples[i]);
+    }
+    else
+    {
+      auto gain = tap->gain, inputEnergy = 0.f, outputEnergy = 0.f;
+
+      for (size_t i = 0; i < numSamples; ++i)
+      {
+        if (tap->input != nullptr)
+          inputEnergy += square (stepWeighted (*tap->weighting, *tap->input, samples[i]));
+
+        const auto y = (float) next (samples[i]);
+
+        if (tap->output != nullptr)
+          outputEnergy += square (stepWeighted (*tap->weighting, *tap->output, y));
+
+        samples[i] = y * gain;
+        gain += tap->gainStep;
+      }
+
+      finishMeter (tap->input, inputEnergy);
+      finishMeter (tap->output, outputEnergy);
+      tap->gain = gain;
+    }
+
+    state.s1 = s1;
+    state.s2 = s2;
+    snapToZero (state.s1);
+    snapToZero (state.s2);
+  }
+
+private:
+  /** One block of a section whose matrices are read from memory, for the
+      K-weighting sections that only run alongside another one.
+  */
+  static SIMDType processBlock (const BlockSectionMatrices& m, BiquadState& st, const float* u) noexcept
+  {
+    const auto* k1 = m.values + k1Offset;
+    const auto* k2 = m.values + k2Offset;
+    const auto* p = m.values + pOffset;
+
+    auto y = SIMDType::fromRawArray (m.values + stateColumnsOffset) * SIMDType::expand (st.s1);
+    y = SIMDType::multiplyAdd (y, SIMDType::fromRawArray (m.values + stateColumnsOffset + blockSize),
+                               SIMDType::expand (st.s2));
+
+    auto n1 = p[0] * st.s1 + p[2] * st.s2;
+    auto n2 = p[1] * st.s1 + p[3] * st.s2;
+
+    for (size_t j = 0; j < blockSize; ++j)
+    {
+      y = SIMDType::multiplyAdd (y, SIMDType::fromRawArray (m.values + j * blockSize), SIMDType::expand (u[j]));
+      n1 += k1[j] * u[j];
+      n2 += k2[j] * u[j];
+    }
+
+    st.s1 = n1;
+    st.s2 = n2;
+    return y;
+  }
+
+  static SIMDType accumulateWeighted (const KWeightingMatrices& weighting, KWeightingState& meter,
+                                      const float* u, float* scratch, SIMDType energy) noexcept
+  {
+    processBlock (weighting.shelf, meter.shelf, u).copyToRawArray (scratch);
+    const auto weighted = processBlock (weighting.highPass, meter.highPass, scratch);
+    return SIMDType::multiplyAdd (energy, weighted, weighted);
+  }
+
+  static float stepWeighted (const KWeightingMatrices& weighting, KWeightingState& meter, float in) noexcept
+  {
+    return step (weighting.highPass.coefficients, meter.highPass,
+                 step (weighting.shelf.coefficients, meter.shelf, in));
+  }
+
+  static void finishMeter (KWeightingState* meter, float energy) noexcept
+  {
+    if (meter == nullptr)
+      return;
+
+    meter->energy += energy;
+    snapToZero (meter->shelf.s1);
+    snapToZero (meter->shelf.s2);
+    snapToZero (meter->highPass.s1);
+    snapToZero (meter->highPass.s2);
+  }
+
+  static float square (float x) noexcept { return x * x; }
+
+  static float step (const BiquadCoefficients& c, BiquadState& st, float in) noexcept
+  {
+    const auto out = c.b0 * in + st.s1;
+    st.s1 = c.b1 * in - c.a1 * out + st.s2;
+    st.s2 = c.b2 * in - c.a2 * out;
+    return out;
+  }
+
+  template <typename Sample>
+  static void snapToZero (Sample& s) noexcept
+  {
+    if (! (s < Sample (-1.0e-8) || s > Sample (1.0e-8)))
+      s = 0;
+  }
+};
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    ButterworthDesign.cpp
+    Closed-form Butterworth low- and high-pass sections, designed straight into
+    a caller-provided array.
+
+  ==============================================================================
+*/
+
+#include "ButterworthDesign.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  constexpr double pi = 3.14159265358979323846;
+}
+
+int designButterworth (double sampleRate, double frequency, int order, bool highPass,
+                       PreciseBiquadCoefficients* sections) noexcept
+{
+  order = std::clamp (order, 1, maxButterworthOrder);
+
+  const auto k = std::tan (pi * std::min (frequency, 0.499 * sampleRate) / sampleRate);
+  const auto k2 = k * k;
+  auto numSections = 0;
+
+  if (order % 2 == 1)
+  {
+    const auto norm = 1.0 / (1.0 + k);
+    const auto b0 = highPass ? norm : k * norm;
+
+    sections[numSections++] = { b0, highPass ? -b0 : b0, 0.0, (k - 1.0) * norm, 0.0 };
+  }
+
+  for (int i = 0; i < order / 2; ++i)
+  {
+    const auto kOverQ = k / getButterworthSectionQ (order, i);
+    const auto norm = 1.0 / (1.0 + kOverQ + k2);
+    const auto b0 = highPass ? norm : k2 * norm;
+
+    sections[numSections++] = { b0, -2.0 * b0 * (highPass ? 1.0 : -1.0), b0,
+                                2.0 * (k2 - 1.0) * norm, (1.0 - kOverQ + k2) * norm };
+  }
+
+  return numSections;
+}
+
+double getButterworthSectionQ (int order, int section) noexcept
+{
+  // The poles sit at (2 section + 1) pi / 2 order from the real axis for even
+  // orders; odd orders put one on the axis and the pairs at (section + 1) pi / order.
+  return 1.0 / (2.0 * std::cos ((2 * section + 1 + order % 2) * pi / (2.0 * order)));
+}
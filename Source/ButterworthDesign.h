@@ -0,0 +1,31 @@
+/*
+  ==============================================================================
+
+    ButterworthDesign.h
+    Closed-form Butterworth low- and high-pass sections, designed straight into
+    a caller-provided array.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockIIR.h"
+
+constexpr int maxButterworthOrder = 8;
+constexpr int maxButterworthSections = (maxButterworthOrder + 1) / 2;
+
+/** Writes the sections of a bilinear Butterworth low- or high-pass of order
+    1 to maxButterworthOrder, prewarped to frequency, and returns how many it
+    wrote, in double precision. Odd orders start with a first order section; the second order
+    sections follow in the order designIIR*HighOrderButterworthMethod gives
+    them. The tangent is evaluated once for all sections and nothing is
+    allocated, so this is safe on the audio thread.
+
+    Frequencies are given in Hz; they are limited to just below Nyquist.
+*/
+int designButterworth (double sampleRate, double frequency, int order, bool highPass,
+                       PreciseBiquadCoefficients* sections) noexcept;
+
+/** Q of each second order section of a Butterworth filter. */
+double getButterworthSectionQ (int order, int section) noexcept;
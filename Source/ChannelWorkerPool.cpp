@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.cpp
+    Pinned real-time worker threads that share the per-channel filtering of
+    wide buses with the audio thread.
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+#include "Trace.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+  inline void cpuRelax() noexcept
+  {
+   #if JUCE_INTEL
+    _mm_pause();
+   #elif JUCE_ARM && (defined (__GNUC__) || defined (__clang__))
+    __asm__ __volatile__ ("yield");
+   #endif
+  }
+
+  constexpr int maxWorkers = 8;
+  constexpr int spinsBeforeSleeping = 4000;
+
+  /** One logical CPU per physical core, in core order. getNumPhysicalCpus()
+      only counts the cores; where the hyperthreads of a core are numbered
+      depends on the system, so pinning by index alone can put two workers
+      on one core.
+  */
+  juce::Array<int> getCoreLeaders()
+  {
+    const auto numCpus = juce::jmax (1, juce::SystemStats::getNumCpus());
+    juce::Array<int> leaders;
+
+   #if JUCE_LINUX
+    // A CPU leads its core if it comes first in its sibling list ("0,8" or "0-1").
+    for (int cpu = 0; cpu < numCpus; ++cpu)
+    {
+      const juce::File siblings ("/sys/devices/system/cpu/cpu" + juce::String (cpu) + "/topology/thread_siblings_list");
+      const auto list = siblings.loadFileAsString().trim();
+
+      if (list.isEmpty())
+      {
+        leaders.clear();
+        break;
+      }
+
+      if (list.getIntValue() == cpu)
+        leaders.add (cpu);
+    }
+
+    if (! leaders.isEmpty())
+      return leaders;
+   #endif
+
+    // Elsewhere the siblings of a core are numbered next to each other.
+    const auto threadsPerCore = juce::jmax (1, numCpus / juce::jmax (1, juce::SystemStats::getNumPhysicalCpus()));
+
+    for (int cpu = 0; cpu < numCpus; cpu += threadsPerCore)
+      leaders.add (cpu);
+
+    return leaders;
+  }
+}
+
+//==============================================================================
+class ChannelWorkerPool::Worker : public juce::Thread
+{
+public:
+  Worker (ChannelWorkerPool& ownerPool, int workerIndex)
+    : juce::Thread ("EQ5b channel worker " + juce::String (workerIndex + 1)),
+      pool (ownerPool)
+  {
+  }
+
+  ~Worker() override
+  {
+    signalThreadShouldExit();
+    wakeUp();
+    stopThread (1000);
+  }
+
+  /** Caller side of the sleep handshake; see run(). */
+  void wakeUpIfSleeping() noexcept
+  {
+    if (sleeping.load())
+      wakeUp();
+  }
+
+  void wakeUp() noexcept
+  {
+    wakeEvent.signal();
+  }
+
+private:
+  void run() override
+  {
+    auto seen = getGeneration (pool.job.load (std::memory_order_acquire));
+
+    while (! threadShouldExit())
+    {
+      auto current = getGeneration (pool.job.load (std::memory_order_acquire));
+
+      for (int spin = 0; current == seen && spin < spinsBeforeSleeping; ++spin)
+      {
+        cpuRelax();
+        current = getGeneration (pool.job.load (std::memory_order_acquire));
+      }
+
+      if (current == seen)
+      {
+        // Both this flag and the job word are sequentially consistent, so
+        // either the caller sees us sleeping or we see its new generation.
+        sleeping.store (true);
+
+        if (getGeneration (pool.job.load()) == seen)
+          wakeEvent.wait (-1);
+
+        sleeping.store (false);
+        continue;
+      }
+
+      // Runs published while this worker was away are skipped; claims only
+      // succeed for the newest.
+      seen = current;
+      pool.runClaimedGroups (seen);
+    }
+  }
+
+  ChannelWorkerPool& pool;
+
+  std::atomic<bool> sleeping { false };
+  juce::WaitableEvent wakeEvent;
+
+  JUCE_DECLARE_NON_COPYABLE (Worker)
+};
+
+//==============================================================================
+ChannelWorkerPool::ChannelWorkerPool()
+{
+  const auto cores = getCoreLeaders();
+  const auto numWorkers = juce::jlimit (0, maxWorkers, cores.size() - 1);
+
+  for (int i = 0; i < numWorkers; ++i)
+  {
+    auto* worker = workers.add (new Worker (*this, i));
+
+    // Leave the first core to the host; the caller's own core is not known here.
+    const auto cpu = cores[i + 1];
+
+    if (cpu < 32)
+      worker->setAffinityMask ((juce::uint32) 1 << cpu);
+
+    if (! worker->startRealtimeThread (juce::Thread::RealtimeOptions().withPriority (8)))
+      worker->startThread (juce::Thread::Priority::highest);
+  }
+}
+
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+  workers.clear();
+}
+
+int ChannelWorkerPool::claimGroup (juce::uint32 forGeneration) noexcept
+{
+  auto current = job.load (std::memory_order_acquire);
+
+  for (;;)
+  {
+    const auto numGroups = (int) ((current >> 16) & 0xffff);
+    const auto next = (int) (current & 0xffff);
+
+    if (getGeneration (current) != forGeneration || next >= numGroups)
+      return -1;
+
+    if (job.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      return next;
+  }
+}
+
+void ChannelWorkerPool::runClaimedGroups (juce::uint32 forGeneration) noexcept
+{
+  for (auto group = claimGroup (forGeneration); group >= 0; group = claimGroup (forGeneration))
+  {
+    {
+      EQ5B_TRACE_SCOPE ("channel group");
+      currentTask (currentContext, group);
+    }
+
+    remaining.fetch_sub (1, std::memory_order_acq_rel);
+  }
+}
+
+bool ChannelWorkerPool::run (int numGroups, void (*task) (void*, int), void* context) noexcept
+{
+  numGroups = juce::jmin (numGroups, getMaxGroups());
+
+  if (numGroups <= 1 || busy.exchange (true, std::memory_order_acquire))
+    return false;
+
+  currentTask = task;
+  currentContext = context;
+  remaining.store (numGroups, std::memory_order_relaxed);
+
+  // Only the caller writes the word while it is busy, and every claim left
+  // the generation alone, so this is the previous run's plus one.
+  const auto generation = getGeneration (job.load (std::memory_order_relaxed)) + 1;
+  job.store (((juce::uint64) generation << 32) | ((juce::uint64) numGroups << 16));
+
+  for (int i = 0; i < numGroups - 1; ++i)
+    workers.getUnchecked (i)->wakeUpIfSleeping();
+
+  runClaimedGroups (generation);
+
+  while (remaining.load (std::memory_order_acquire) > 0)
+    cpuRelax();
+
+  busy.store (false, std::memory_order_release);
+  return true;
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.h
+    Pinned real-time worker threads that share the per-channel filtering of
+    wide buses with the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** One pool per process, shared by every instance that turns channelThreads
+    on through a SharedResourcePointer. run() forks a task over a number of
+    groups: the calling thread and the workers claim groups until none are
+    left, and the call returns once every group is done. A worker that wakes
+    late finds the groups taken and the caller has done its share.
+
+    Forking and joining are lock-free. The caller publishes each run as one
+    atomic word holding its generation, group count and next unclaimed group;
+    a group is claimed by a compare-and-swap on that word, which only succeeds
+    for the generation the claimer woke for, so no group runs twice and no
+    thread can take part in a later run on the strength of an earlier wake-up.
+    The task and its context are only read after a successful claim, whose
+    acquire pairs with the release that published them, and the caller cannot
+    replace them before the claimed group has counted itself done.
+
+    Workers spin briefly after each run and then sleep on an event, which the
+    caller only signals for workers that are actually asleep. Each is pinned
+    to its own physical core, leaving the first to the host.
+
+    Only one run() can be in flight; a caller that finds the pool busy (another
+    instance on another host thread) gets false back and should do the work
+    itself.
+*/
+class ChannelWorkerPool
+{
+public:
+  ChannelWorkerPool();
+  ~ChannelWorkerPool();
+
+  /** The most groups run() can split work into, including the caller's. */
+  int getMaxGroups() const noexcept { return workers.size() + 1; }
+
+  bool run (int numGroups, void (*task) (void* context, int group), void* context) noexcept;
+
+  template <typename Task>
+  bool run (int numGroups, Task& task) noexcept
+  {
+    return run (numGroups, [] (void* context, int group) { (*static_cast<Task*> (context)) (group); }, &task);
+  }
+
+private:
+  class Worker;
+
+  static juce::uint32 getGeneration (juce::uint64 job) noexcept { return (juce::uint32) (job >> 32); }
+
+  /** The next group of the run published as forGeneration, or -1 once they
+      are all claimed or a later run has been published.
+  */
+  int claimGroup (juce::uint32 forGeneration) noexcept;
+
+  /** Runs groups of the current run until none are left to claim. */
+  void runClaimedGroups (juce::uint32 forGeneration) noexcept;
+
+  // Written by the caller before the job word is published, and read only
+  // by a thread that has claimed a group of that job.
+  void (*currentTask) (void*, int) = nullptr;
+  void* currentContext = nullptr;
+
+  // generation << 32 | number of groups << 16 | next unclaimed group
+  std::atomic<juce::uint64> job { 0 };
+  std::atomic<int> remaining { 0 };
+  std::atomic<bool> busy { false };
+
+  juce::OwnedArray<Worker> workers;
+
+  JUCE_DECLARE_NON_COPYABLE (ChannelWorkerPool)
+};
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    DSPKernels.cpp
+    Filtering and response-evaluation kernels, compiled once per instruction
+    set and picked at load time from the running CPU's features.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+
+namespace
+{
+  const DSPKernels& chooseKernels()
+  {
+    using namespace DSPKernelVariants;
+
+    const auto* avx512 = juce::SystemStats::hasAVX512F() ? getAVX512() : nullptr;
+    const auto* avx2 = juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() ? getAVX2() : nullptr;
+    const auto* generic = getGeneric();
+
+    const auto forced = juce::SystemStats::getEnvironmentVariable ("EQ5B_KERNELS", {}).trim().toLowerCase();
+    const DSPKernels* chosen = nullptr;
+
+    if (forced == "generic")     chosen = generic;
+    else if (forced == "avx2")   chosen = avx2;
+    else if (forced == "avx512") chosen = avx512;
+
+    if (forced.isNotEmpty() && chosen == nullptr)
+      DBG ("EQ5B_KERNELS=" << forced << " is not available on this machine, using the default");
+
+    if (chosen == nullptr)
+      chosen = avx512 != nullptr ? avx512 : avx2 != nullptr ? avx2 : generic;
+
+    DBG ("EQ5b DSP kernels: " << chosen->name);
+    return *chosen;
+  }
+}
+
+const DSPKernels& DSPKernels::get()
+{
+  static const DSPKernels& kernels = chooseKernels();
+  return kernels;
+}
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    DSPKernels.h
+    Filtering and response-evaluation kernels, compiled once per instruction
+    set and picked at load time from the running CPU's features.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockIIR.h"
+#include "LevelMeter.h"
+#include "ParallelForm.h"
+
+/** One instruction set's build of every vectorised kernel. ParallelFormLanes
+    is laid out for the widest variant, so it can be shared regardless of
+    which table is active. BlockSectionMatrices are laid out for blockSize
+    and must be designed by the same table that processes them, in a
+    BlockSectionArray made for its blockSize.
+*/
+struct DSPKernels
+{
+  const char* name;
+  size_t blockSize;
+
+  void (*designBlockSection) (const BiquadCoefficients&, BlockSectionMatrices&) noexcept;
+  void (*processBlockSection) (const BlockSectionMatrices&, BiquadState&, float*, size_t) noexcept;
+  void (*processBlockSectionMetered) (const BlockSectionMatrices&, BiquadState&, float*, size_t, LoudnessTap&) noexcept;
+  void (*processPreciseSection) (const PreciseBiquadCoefficients&, PreciseBiquadState&, float*, size_t, LoudnessTap*) noexcept;
+  void (*processParallel) (const ParallelFormLanes&, ParallelFormLanes::State&, float*, size_t) noexcept;
+  void (*magnitudeResponse) (const BiquadCoefficients*, int, const float*, float*, size_t) noexcept;
+  void (*frequencyResponse) (const BiquadCoefficients*, int, const float*, const float*,
+                             float*, float*, float*, size_t) noexcept;
+  void (*measureLevels) (const float*, const float*, size_t, LevelSums&) noexcept;
+
+  /** The widest variant the CPU supports, chosen on the first call. Setting the
+      environment variable EQ5B_KERNELS to generic, avx2 or avx512 forces that
+      variant instead, as long as the CPU can run it.
+  */
+  static const DSPKernels& get();
+};
+
+namespace DSPKernelVariants
+{
+  /** Built with the project's default flags (SSE2 on x86-64, NEON on arm64). */
+  const DSPKernels* getGeneric() noexcept;
+
+  /** These return nullptr when the file was built without the matching flags. */
+  const DSPKernels* getAVX2() noexcept;
+  const DSPKernels* getAVX512() noexcept;
+}
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    DSPKernels_AVX2.cpp
+    Kernel table for the "avx2" compiler flag scheme. Must not include
+    JuceHeader.h: see SIMDLanes.h.
+
+  ==============================================================================
+*/
+
+#include "DSPKernels.h"
+#include "MagnitudeResponse.h"
+#include "SIMDLanes.h"
+
+#if defined (__AVX2__) && defined (__FMA__)
+
+namespace
+{
+  struct AVX2Tag {};
+  using Lanes = FloatLanes<8, AVX2Tag>;
+
+  const DSPKernels kernels { "avx2", Lanes::SIMDNumElements,
+                             BlockStateSpaceKernel<Lanes>::design,
+                             BlockStateSpaceKernel<Lanes>::process,
+                             BlockStateSpaceKernel<Lanes>::processMetered,
+                             BlockStateSpaceKernel<Lanes>::processPrecise,
+                             ParallelFormKernel<Lanes>::process,
+                             MagnitudeResponseKernel<Lanes>::process,
+                             FrequencyResponseKernel<Lanes>::process,
+                             LevelMeterKernel<Lanes>::process };
+}
+
+const DSPKernels* DSPKernelVariants::getAVX2() noexcept { return &kernels; }
+
+#else
+
+const DSPKernels* DSPKernelVariants::getAVX2() noexcept { return nullptr; }
+
+#endif
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    DSPKernels_AVX512.cpp
+    Kernel table for the "avx512" compiler flag scheme. Must not include
+    JuceHeader.h: see SIMDLanes.h.
+
+  ==============================================================================
+*/
+
+#include "DSPKernels.h"
+#include "MagnitudeResponse.h"
+#include "SIMDLanes.h"
+
+#if defined (__AVX512F__) && defined (__FMA__)
+
+namespace
+{
+  struct AVX512Tag {};
+  using Lanes = FloatLanes<16, AVX512Tag>;
+
+  const DSPKernels kernels { "avx512", Lanes::SIMDNumElements,
+                             BlockStateSpaceKernel<Lanes>::design,
+                             BlockStateSpaceKernel<Lanes>::process,
+                             BlockStateSpaceKernel<Lanes>::processMetered,
+                             BlockStateSpaceKernel<Lanes>::processPrecise,
+                             ParallelFormKernel<Lanes>::process,
+                             MagnitudeResponseKernel<Lanes>::process,
+                             FrequencyResponseKernel<Lanes>::process,
+                             LevelMeterKernel<Lanes>::process };
+}
+
+const DSPKernels* DSPKernelVariants::getAVX512() noexcept { return &kernels; }
+
+#else
+
+const DSPKernels* DSPKernelVariants::getAVX512() noexcept { return nullptr; }
+
+#endif
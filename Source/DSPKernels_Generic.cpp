@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    DSPKernels_Generic.cpp
+    Kernel table built with the project's default compiler flags.
+
+  ==============================================================================
+*/
+
+#include "DSPKernels.h"
+#include "MagnitudeResponse.h"
+#include "SIMDLanes.h"
+
+namespace
+{
+  struct GenericTag {};
+  using Lanes = FloatLanes<4, GenericTag>;
+
+  const DSPKernels kernels { "generic", Lanes::SIMDNumElements,
+                             BlockStateSpaceKernel<Lanes>::design,
+                             BlockStateSpaceKernel<Lanes>::process,
+                             BlockStateSpaceKernel<Lanes>::processMetered,
+                             BlockStateSpaceKernel<Lanes>::processPrecise,
+                             ParallelFormKernel<Lanes>::process,
+                             MagnitudeResponseKernel<Lanes>::process,
+                             FrequencyResponseKernel<Lanes>::process,
+                             LevelMeterKernel<Lanes>::process };
+}
+
+const DSPKernels* DSPKernelVariants::getGeneric() noexcept { return &kernels; }
@@ -0,0 +1,664 @@
+/*
+  ==============================================================================
+
+    FilterCascade.cpp
+    The active sections of a FilterBank, run on every channel of the
+    audio buffer.
+
+  ==============================================================================
+*/
+
+#include "FilterCascade.h"
+
+int getActiveSections (const FilterBank& bank,
+                       std::array<BiquadCoefficients, FilterCascade::numSlots>& sections)
+{
+  auto numSections = 0;
+
+  for (size_t slot = 0; slot < (size_t) FilterBank::numSlots; ++slot)
+    if (bank.active[slot] && ! bank.coefficients[slot].isIdentity())
+      sections[(size_t) numSections++] = bank.coefficients[slot];
+
+  return numSections;
+}
+
+namespace
+{
+  constexpr double pi = 3.14159265358979323846;
+
+  /** The BS.1770 pre-filter, a high shelf of about +4 dB, at any sample rate. */
+  BiquadCoefficients designKWeightingShelf (double sampleRate)
+  {
+    const auto k = std::tan (pi * 1681.974450955533 / sampleRate);
+    const auto q = 0.7071752369554196;
+    const auto vh = std::pow (10.0, 3.999843853973347 / 20.0);
+    const auto vb = std::pow (vh, 0.4996667741545416);
+    const auto a0 = 1.0 + k / q + k * k;
+
+    return { (float) ((vh + vb * k / q + k * k) / a0), (float) (2.0 * (k * k - vh) / a0),
+             (float) ((vh - vb * k / q + k * k) / a0), (float) (2.0 * (k * k - 1.0) / a0),
+             (float) ((1.0 - k / q + k * k) / a0) };
+  }
+
+  /** The BS.1770 RLB high-pass. Its numerator is left unnormalised as in the
+      standard; only power ratios are used.
+  */
+  BiquadCoefficients designKWeightingHighPass (double sampleRate)
+  {
+    const auto k = std::tan (pi * 38.13547087602444 / sampleRate);
+    const auto q = 0.5003270373238773;
+    const auto a0 = 1.0 + k / q + k * k;
+
+    return { 1.f, -2.f, 1.f, (float) (2.0 * (k * k - 1.0) / a0), (float) ((1.0 - k / q + k * k) / a0) };
+  }
+}
+
+FilterCascade::Form getFilterForm (juce::AudioProcessorValueTreeState& processorParameters)
+{
+  return static_cast<FilterCascade::Form> (processorParameters.getRawParameterValue ("filterForm")->load());
+}
+
+//==============================================================================
+FilterCascade::FilterCascade()
+  : blockSections (numSlots, kernels.blockSize),
+    spareSections (numSlots, kernels.blockSize),
+    meteringSections (3, kernels.blockSize)
+{
+  kWeighting = { meteringSections[0], meteringSections[1] };
+  identitySection = meteringSections[2];
+  kernels.designBlockSection ({}, identitySection);
+}
+
+FilterCascade::~FilterCascade()
+{
+  if (designer != nullptr)
+    (*designer)->removeClient (designerClient);
+}
+
+void FilterCascade::prepare (int numChannels, double newSampleRate)
+{
+  const auto channels = (size_t) juce::jmax (numChannels, 0);
+  states.resize (channels);
+  preciseStates.resize (channels);
+  outgoingStates.resize (channels);
+  outgoingPreciseStates.resize (channels);
+  outgoingOutput.resize (channels);
+  loudnessMeters.resize (channels);
+
+  sampleRate = newSampleRate;
+  kernels.designBlockSection (designKWeightingShelf (sampleRate), kWeighting.shelf);
+  kernels.designBlockSection (designKWeightingHighPass (sampleRate), kWeighting.highPass);
+  warmUpLength = juce::roundToInt (warmUpSeconds * newSampleRate);
+  fadeLength = juce::jmax (1, juce::roundToInt (fadeSeconds * newSampleRate));
+  parallelPrefixStates.resize (channels);
+  parallelPrefixPreciseStates.resize (channels);
+  parallelStates.resize (channels);
+  reset();
+}
+
+void FilterCascade::reset()
+{
+  for (auto& channel : states)
+    for (auto& state : channel)
+      state.reset();
+
+  for (auto& channel : preciseStates)
+    for (auto& state : channel)
+      state.reset();
+
+  for (auto& channel : parallelPrefixStates)
+    for (auto& state : channel)
+      state.reset();
+
+  for (auto& channel : parallelPrefixPreciseStates)
+    for (auto& state : channel)
+      state.reset();
+
+  for (auto& state : parallelStates)
+    state.reset();
+
+  for (auto& meters : loudnessMeters)
+    for (auto& meter : meters)
+      meter.reset();
+
+  inputPower = outputPower = 0;
+
+  transitionPosition = -1;
+  hasProcessed = false;
+}
+
+void FilterCascade::setAutoGain (bool enabled) noexcept
+{
+  if (enabled && ! autoGain)
+  {
+    for (auto& meters : loudnessMeters)
+      for (auto& meter : meters)
+        meter.reset();
+
+    inputPower = outputPower = 0;
+  }
+
+  autoGain = enabled;
+}
+
+void FilterCascade::setForm (Form newForm) noexcept
+{
+  if (newForm == form)
+    return;
+
+  form = newForm;
+  parallelReady = false;
+  parallelRequestPending = form == Form::parallel;
+}
+
+void FilterCascade::startParallelDesigner()
+{
+  const juce::ScopedLock sl (designerLock);
+
+  if (designer != nullptr)
+    return;
+
+  designer = std::make_unique<juce::SharedResourcePointer<ParallelFormDesigner>>();
+  (*designer)->addClient (designerClient);
+  designerStarted.store (true, std::memory_order_release);
+}
+
+bool FilterCascade::setSlot (int slot, const FilterBank& bank)
+{
+  const auto& biquad = bank.coefficients[(size_t) slot];
+  const auto& exact = bank.preciseCoefficients[(size_t) slot];
+  const auto active = bank.active[(size_t) slot];
+  const auto precise = active && needsDoublePrecision (biquad);
+  const auto wasActive = slotActive[(size_t) slot];
+  auto changed = active != wasActive;
+
+  if (active)
+  {
+    for (size_t ch = 0; ch < states.size(); ++ch)
+    {
+      auto& state = states[ch][(size_t) slot];
+      auto& preciseState = preciseStates[ch][(size_t) slot];
+
+      if (! wasActive)
+      {
+        state.reset();
+        preciseState.reset();
+      }
+      else if (precise && ! slotPrecise[(size_t) slot])
+      {
+        preciseState = { state.s1, state.s2 };
+      }
+      else if (! precise && slotPrecise[(size_t) slot])
+      {
+        state = { (float) preciseState.s1, (float) preciseState.s2 };
+      }
+    }
+  }
+
+  if (active && (exact != preciseCoefficients[(size_t) slot] || ! wasActive))
+  {
+    coefficients[(size_t) slot] = biquad;
+    preciseCoefficients[(size_t) slot] = exact;
+
+    // A section in double precision only needs its coefficients.
+    if (! precise)
+      kernels.designBlockSection (biquad, blockSections[(size_t) slot]);
+
+    changed = true;
+  }
+
+  slotActive[(size_t) slot] = active;
+  slotPrecise[(size_t) slot] = precise;
+
+  if (active)
+    activeSlots[(size_t) numActive++] = slot;
+
+  return changed;
+}
+
+void FilterCascade::setSections (const FilterBank& bank)
+{
+  if (form == Form::cascade && hasProcessed)
+  {
+    if (isTransitioning() && transitionPosition >= warmUpLength)
+      return;
+
+    auto activityChanged = false;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+      activityChanged |= bank.active[(size_t) slot] != slotActive[(size_t) slot];
+
+    if (activityChanged)
+      beginTransition (bank);
+  }
+
+  numActive = 0;
+  auto changed = false;
+
+  for (int slot = 0; slot < numSlots; ++slot)
+    changed |= setSlot (slot, bank);
+
+  if (form == Form::parallel && (changed || parallelRequestPending))
+    requestParallelDesign();
+}
+
+void FilterCascade::beginTransition (const FilterBank& bank) noexcept
+{
+  const auto settleSeconds = bank.lowestCutHz > 0.f ? warmUpCycles / bank.lowestCutHz : 0.0;
+  const auto length = juce::roundToInt (juce::jmax (warmUpSeconds, settleSeconds) * sampleRate);
+
+  // During the warm-up the outgoing sections are still all that is heard, so
+  // they stay, and the incoming ones settle until the warm-up is over.
+  // Restarting it instead would let a stream of changes hold the fade off.
+  if (isTransitioning())
+  {
+    warmUpLength = juce::jmax (warmUpLength, length);
+    return;
+  }
+
+  for (int i = 0; i < numActive; ++i)
+  {
+    const auto slot = (size_t) activeSlots[(size_t) i];
+    spareSections.assign (slot, blockSections[slot]);
+    sparePrecise[slot] = slotPrecise[slot];
+    spareCoefficients[slot] = preciseCoefficients[slot];
+    outgoingSlots[(size_t) i] = (int) slot;
+  }
+
+  numOutgoing = numActive;
+  std::copy (states.begin(), states.end(), outgoingStates.begin());
+  std::copy (preciseStates.begin(), preciseStates.end(), outgoingPreciseStates.begin());
+
+  warmUpLength = length;
+  transitionPosition = 0;
+}
+
+void FilterCascade::requestParallelDesign() noexcept
+{
+  // The request stays pending until there is a designer to take it.
+  if (! designerStarted.load (std::memory_order_acquire))
+  {
+    parallelRequestPending = true;
+    return;
+  }
+
+  auto& request = designerClient.requests.getWriteBuffer();
+  auto numSections = 0;
+
+  // Unity sections only keep the cascade's states going; expanded, they would
+  // add a pole pair with no residue.
+  for (int i = 0; i < numActive; ++i)
+  {
+    const auto slot = (size_t) activeSlots[(size_t) i];
+
+    if (! coefficients[slot].isIdentity())
+      request.sections[(size_t) numSections++] = preciseCoefficients[slot];
+  }
+
+  request.numSections = numSections;
+  designerClient.requests.publish();
+  (*designer)->wakeUp();
+
+  parallelRequestPending = false;
+}
+
+void FilterCascade::pullParallelDesign() noexcept
+{
+  if (! designerClient.results.pull())
+    return;
+
+  const auto& design = designerClient.results.getReadBuffer();
+
+  if (! design.valid)
+  {
+    parallelReady = false;
+    return;
+  }
+
+  // A new design with the same shape keeps its states, like any coefficient
+  // change in the cascade; a different shape, or a leading section that
+  // changes precision, starts from silence.
+  auto sameShape = parallelReady && design.numCascadeSections == numParallelPrefix;
+
+  for (size_t i = 0; i < (size_t) design.numCascadeSections; ++i)
+  {
+    const auto& exact = design.cascadeSections[i];
+    const auto biquad = exact.toFloat();
+    const auto precise = needsDoublePrecision (biquad);
+
+    sameShape = sameShape && precise == sparePrecise[i];
+    sparePrecise[i] = precise;
+    spareCoefficients[i] = exact;
+
+    if (! precise)
+      kernels.designBlockSection (biquad, spareSections[i]);
+  }
+
+  numParallelPrefix = design.numCascadeSections;
+  parallelSections.setDesign (design);
+
+  if (! sameShape)
+  {
+    for (auto& channel : parallelPrefixStates)
+      for (auto& state : channel)
+        state.reset();
+
+    for (auto& channel : parallelPrefixPreciseStates)
+      for (auto& state : channel)
+        state.reset();
+
+    for (auto& state : parallelStates)
+      state.reset();
+  }
+
+  parallelReady = true;
+}
+
+void FilterCascade::process (const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+{
+  auto& block = context.getOutputBlock();
+  const auto numSamples = block.getNumSamples();
+  const auto numChannels = juce::jmin (block.getNumChannels(), states.size());
+
+  if (context.isBypassed)
+    return;
+
+  if (form == Form::parallel)
+    pullParallelDesign();
+
+  const auto useParallel = form == Form::parallel && parallelReady;
+
+  // Switching between forms cannot carry the filter state over, so the form
+  // being switched to starts from silence rather than from stale state.
+  if (useParallel != processedParallel)
+  {
+    reset();
+    processedParallel = useParallel;
+  }
+
+  const auto work = numChannels * numSamples * (size_t) juce::jmax (useParallel ? numParallelPrefix + 1 : numActive, 1);
+  const auto numGroups = channelWorkers != nullptr
+                           ? (int) juce::jmin (numChannels, (size_t) channelWorkers->getMaxGroups(), work / minWorkPerGroup)
+                           : 1;
+
+  applyingGain = autoGain || makeupGain != 1.f || targetGain != 1.f;
+  metering = autoGain && ! isTransitioning();
+  gainStep = numSamples > 0 ? (targetGain - makeupGain) / (float) numSamples : 0.f;
+
+  auto processGroup = [&] (int group)
+  {
+    processChannels (block, numChannels * (size_t) group / (size_t) numGroups,
+                     numChannels * (size_t) (group + 1) / (size_t) numGroups, useParallel, nullptr);
+  };
+
+  // The correlation needs both channels of a chunk, which groups split.
+  const auto splitMeters = signalMeters != nullptr && numGroups > 1;
+
+  if (splitMeters)
+    signalMeters->add (SignalMeters::Stage::input, block);
+
+  if (numGroups <= 1 || ! channelWorkers->run (numGroups, processGroup))
+    processChannels (block, 0, numChannels, useParallel, splitMeters ? nullptr : signalMeters);
+
+  if (splitMeters)
+    signalMeters->add (SignalMeters::Stage::output, block);
+
+  hasProcessed = true;
+
+  if (applyingGain)
+    updateMakeupGain (numChannels, numSamples);
+
+  if (isTransitioning())
+  {
+    transitionPosition += (int) numSamples;
+
+    if (useParallel || transitionPosition >= warmUpLength + fadeLength)
+      transitionPosition = -1;
+  }
+}
+
+void FilterCascade::copyChannelState (const FilterCascade& source, int sourceChannel, int channel) noexcept
+{
+  const auto from = (size_t) sourceChannel, to = (size_t) channel;
+
+  if (from >= source.states.size() || to >= states.size())
+    return;
+
+  // Only the state of the precision the source runs a section in is up to
+  // date, so both of the target's are set from that one.
+  auto carry = [] (const BiquadState& state, const PreciseBiquadState& preciseState, bool precise,
+                   BiquadState& target, PreciseBiquadState& preciseTarget)
+  {
+    target = precise ? BiquadState { (float) preciseState.s1, (float) preciseState.s2 } : state;
+    preciseTarget = precise ? preciseState : PreciseBiquadState { state.s1, state.s2 };
+  };
+
+  for (size_t slot = 0; slot < (size_t) numSlots; ++slot)
+    carry (source.states[from][slot], source.preciseStates[from][slot], source.slotPrecise[slot],
+           states[to][slot], preciseStates[to][slot]);
+
+  if (isTransitioning())
+  {
+    outgoingStates[to] = states[to];
+    outgoingPreciseStates[to] = preciseStates[to];
+  }
+
+  // Mid-transition, the source's outgoing sections are the ones heard, so
+  // the sections this cascade plays go on from theirs.
+  if (source.isTransitioning())
+  {
+    auto& heard = isTransitioning() ? outgoingStates[to] : states[to];
+    auto& preciseHeard = isTransitioning() ? outgoingPreciseStates[to] : preciseStates[to];
+
+    for (int i = 0; i < source.numOutgoing; ++i)
+    {
+      const auto slot = (size_t) source.outgoingSlots[(size_t) i];
+      carry (source.outgoingStates[from][slot], source.outgoingPreciseStates[from][slot], source.sparePrecise[slot],
+             heard[slot], preciseHeard[slot]);
+    }
+  }
+
+  loudnessMeters[to] = source.loudnessMeters[from];
+
+  if (parallelReady && source.parallelReady && numParallelPrefix == source.numParallelPrefix)
+  {
+    for (size_t i = 0; i < (size_t) numParallelPrefix; ++i)
+      carry (source.parallelPrefixStates[from][i], source.parallelPrefixPreciseStates[from][i],
+             source.sparePrecise[i], parallelPrefixStates[to][i], parallelPrefixPreciseStates[to][i]);
+
+    parallelStates[to] = source.parallelStates[from];
+  }
+}
+
+void FilterCascade::processChannels (const juce::dsp::AudioBlock<float>& block, size_t begin, size_t end,
+                                     bool useParallel, SignalMeters* meters) noexcept
+{
+  const auto numSamples = block.getNumSamples();
+
+  // Chunk by chunk across the channels, so the meters see every channel of a
+  // chunk while it is in cache.
+  for (size_t start = 0; start < numSamples; start += processChunk)
+  {
+    const auto length = juce::jmin (processChunk, numSamples - start);
+    const auto chunk = block.getSubBlock (start, length);
+
+    if (meters != nullptr)
+      meters->add (SignalMeters::Stage::input, chunk);
+
+    for (size_t ch = begin; ch < end; ++ch)
+    {
+      auto* samples = block.getChannelPointer (ch) + start;
+
+      if (useParallel)
+        processParallelForm (ch, samples, length, start);
+      else if (isTransitioning())
+        processTransition (ch, samples, length, start);
+      else
+        processCascade (ch, samples, length, start);
+    }
+
+    if (meters != nullptr)
+      meters->add (SignalMeters::Stage::output, chunk);
+  }
+}
+
+void FilterCascade::processCascade (size_t channel, float* samples, size_t numSamples, size_t start) noexcept
+{
+  auto& channelState = states[channel];
+  auto& preciseState = preciseStates[channel];
+
+  if (! applyingGain)
+  {
+    // Section-major: each section runs over the whole chunk before the next one,
+    // so every section's recursion only waits on its own 2 x 2 state update.
+    for (int i = 0; i < numActive; ++i)
+    {
+      const auto slot = (size_t) activeSlots[(size_t) i];
+      processSection (blockSections[slot], getExactCoefficients (slot), channelState[slot], preciseState[slot],
+                      samples, numSamples, nullptr);
+    }
+
+    return;
+  }
+
+  auto tap = getLoudnessTap (channel, start);
+
+  if (numActive == 0)
+  {
+    BiquadState identityState;
+    kernels.processBlockSectionMetered (identitySection, identityState, samples, numSamples, tap);
+    return;
+  }
+
+  // The input is metered in the first section's pass; the output is metered
+  // and the gain applied in the last one's.
+  for (int i = 0; i < numActive; ++i)
+  {
+    const auto slot = (size_t) activeSlots[(size_t) i];
+    const auto first = i == 0, last = i == numActive - 1;
+
+    LoudnessTap sectionTap { tap.weighting, first ? tap.input : nullptr, last ? tap.output : nullptr,
+                             last ? tap.gain : 1.f, last ? tap.gainStep : 0.f };
+
+    processSection (blockSections[slot], getExactCoefficients (slot), channelState[slot], preciseState[slot],
+                    samples, numSamples, first || last ? &sectionTap : nullptr);
+  }
+}
+
+void FilterCascade::processSection (const BlockSectionMatrices& m, const PreciseBiquadCoefficients* exact,
+                                    BiquadState& state, PreciseBiquadState& preciseState, float* samples,
+                                    size_t numSamples, LoudnessTap* tap) noexcept
+{
+  if (exact != nullptr)
+    kernels.processPreciseSection (*exact, preciseState, samples, numSamples, tap);
+  else if (tap != nullptr)
+    kernels.processBlockSectionMetered (m, state, samples, numSamples, *tap);
+  else
+    kernels.processBlockSection (m, state, samples, numSamples);
+}
+
+void FilterCascade::processParallelForm (size_t channel, float* samples, size_t numSamples, size_t start) noexcept
+{
+  auto& prefixState = parallelPrefixStates[channel];
+  auto& prefixPreciseState = parallelPrefixPreciseStates[channel];
+  auto tap = getLoudnessTap (channel, start);
+  BiquadState identityState;
+
+  // The parallel form has no first and last section to ride along with, so the
+  // taps take passes of their own.
+  if (applyingGain)
+  {
+    LoudnessTap inputTap { tap.weighting, tap.input, nullptr, 1.f, 0.f };
+    kernels.processBlockSectionMetered (identitySection, identityState, samples, numSamples, inputTap);
+  }
+
+  for (size_t i = 0; i < (size_t) numParallelPrefix; ++i)
+    processSection (spareSections[i], getSpareCoefficients (i), prefixState[i], prefixPreciseState[i],
+                    samples, numSamples, nullptr);
+
+  kernels.processParallel (parallelSections, parallelStates[channel], samples, numSamples);
+
+  if (applyingGain)
+  {
+    LoudnessTap outputTap { tap.weighting, nullptr, tap.output, tap.gain, tap.gainStep };
+    kernels.processBlockSectionMetered (identitySection, identityState, samples, numSamples, outputTap);
+  }
+}
+
+LoudnessTap FilterCascade::getLoudnessTap (size_t channel, size_t start) noexcept
+{
+  auto& meters = loudnessMeters[channel];
+  return { &kWeighting, metering ? &meters[0] : nullptr, metering ? &meters[1] : nullptr,
+           makeupGain + gainStep * (float) start, gainStep };
+}
+
+void FilterCascade::updateMakeupGain (size_t numChannels, size_t numSamples) noexcept
+{
+  makeupGain = targetGain;
+
+  if (! autoGain)
+  {
+    targetGain = 1.f;
+    return;
+  }
+
+  if (! metering || numSamples == 0)
+    return;
+
+  double inputEnergy = 0, outputEnergy = 0;
+
+  for (size_t ch = 0; ch < numChannels; ++ch)
+  {
+    auto& meters = loudnessMeters[ch];
+    inputEnergy += std::exchange (meters[0].energy, 0.0);
+    outputEnergy += std::exchange (meters[1].energy, 0.0);
+  }
+
+  const auto alpha = 1.0 - std::exp (-(double) numSamples / (loudnessSeconds * sampleRate));
+  inputPower += alpha * (inputEnergy / (double) numSamples - inputPower);
+  outputPower += alpha * (outputEnergy / (double) numSamples - outputPower);
+
+  if (inputPower < loudnessGatePower)
+    return;
+
+  const auto maxGain = juce::Decibels::decibelsToGain (maxMakeupDb);
+  targetGain = outputPower * maxGain * maxGain > inputPower
+                 ? juce::jlimit (1.f / maxGain, maxGain, (float) std::sqrt (inputPower / outputPower))
+                 : maxGain;
+}
+
+void FilterCascade::processTransition (size_t channel, float* samples, size_t numSamples, size_t start) noexcept
+{
+  auto* outgoing = outgoingOutput[channel].samples;
+  auto& incomingState = states[channel];
+  auto& incomingPreciseState = preciseStates[channel];
+  auto& outgoingState = outgoingStates[channel];
+  auto& outgoingPreciseState = outgoingPreciseStates[channel];
+
+  std::copy (samples, samples + numSamples, outgoing);
+
+  for (int i = 0; i < numOutgoing; ++i)
+  {
+    const auto slot = (size_t) outgoingSlots[(size_t) i];
+    processSection (spareSections[slot], getSpareCoefficients (slot), outgoingState[slot], outgoingPreciseState[slot],
+                    outgoing, numSamples, nullptr);
+  }
+
+  for (int i = 0; i < numActive; ++i)
+  {
+    const auto slot = (size_t) activeSlots[(size_t) i];
+    processSection (blockSections[slot], getExactCoefficients (slot), incomingState[slot], incomingPreciseState[slot],
+                    samples, numSamples, nullptr);
+  }
+
+  // Only the outgoing sections are heard until the warm-up is over. The
+  // meters pause; the makeup gain keeps ramping.
+  const auto position = transitionPosition + (int) start - warmUpLength;
+  const auto startGain = makeupGain + gainStep * (float) start;
+
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    const auto mix = juce::jlimit (0.f, 1.f, (float) (position + (int) i) / (float) fadeLength);
+    samples[i] = (outgoing[i] + mix * (samples[i] - outgoing[i])) * (startGain + gainStep * (float) i);
+  }
+}
@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    FilterCascade.h
+    The active sections of a FilterBank, run on every channel of the
+    audio buffer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "DSPKernels.h"
+#include "ParallelFormDesigner.h"
+#include "ChannelWorkerPool.h"
+#include "SignalMeters.h"
+
+class FilterCascade
+{
+public:
+  /** One slot per FilterBank slot; only the active ones are processed. */
+  static constexpr int numSlots = FilterBank::numSlots;
+
+  /** How the active sections are evaluated. In parallel form the cascade is
+      expanded off the audio thread after every change; until the first
+      expansion arrives, or if it is rejected as inaccurate, the cascade is used.
+  */
+  enum class Form
+  {
+    cascade,
+    parallel
+  };
+
+  FilterCascade();
+  ~FilterCascade();
+
+  void prepare (int numChannels, double newSampleRate);
+  void reset();
+
+  void setForm (Form newForm) noexcept;
+
+  /** Registers with the background designer that the parallel form needs,
+      creating its thread if no other instance has. Instances that never run
+      the parallel form never call it, so they cost the designer nothing. It
+      allocates and may start a thread, so setForm(), which runs on the audio
+      thread, leaves it to the caller; until it has been called the parallel
+      form runs as the cascade, as it does while a design is pending. Safe to
+      call from any thread but the audio thread.
+  */
+  void startParallelDesigner();
+  bool hasParallelDesigner() const noexcept { return designerStarted.load(); }
+
+  /** Copies the coefficients of every active slot of the bank. A peak at
+      0 dB stays active as a unity section, so that its state carries on when
+      the gain moves off 0 dB again; the parallel form leaves it out.
+      Sections whose coefficients did not change keep their block matrices;
+      sections that wake up start from a cleared state. In cascade form,
+      sections that needsDoublePrecision() picks run the scalar recursion in
+      double on the bank's preciseCoefficients instead of the block kernel,
+      and move between the two with their state when their coefficients cross
+      over.
+
+      In cascade form, a bank that switches sections on or off (a slope or band
+      count change) does not take over at once: the previous sections keep
+      running while the new ones settle on the same input, for warmUpCycles of
+      the bank's lowest cut-off but at least warmUpSeconds, then the output
+      crossfades to them over fadeSeconds. Changes during the warm-up join it
+      instead of restarting it, lengthening it only if their cut-offs need
+      longer, so the fade always follows one warm-up; changes during the fade
+      wait for it to finish.
+  */
+  void setSections (const FilterBank& bank);
+
+  /** Makes up for the loudness the EQ adds or removes. The input and output
+      are K-weighted as in ITU-R BS.1770 and their mean powers, summed over the
+      channels, are averaged over about loudnessSeconds; the ratio gives the
+      makeup gain, ramped across each block. The weighting and the ramp run
+      inside the passes of the first and last sections, so the cost is four
+      extra biquads per channel. Quiet input below the BS.1770 absolute gate
+      holds the gain; switching off ramps it back to unity.
+  */
+  void setAutoGain (bool enabled) noexcept;
+
+  /** With a pool, blocks that carry enough work are split into channel groups
+      that run on the pool's workers; nullptr processes every channel inline.
+  */
+  void setChannelWorkers (ChannelWorkerPool* pool) noexcept { channelWorkers = pool; }
+
+  /** With meters, every chunk is added to their input stage just before it is
+      run and to their output stage just after, while it is still in cache;
+      publishing is left to the caller. Blocks split across channel workers
+      are added whole instead, before and after the split.
+  */
+  void setSignalMeters (SignalMeters* meters) noexcept { signalMeters = meters; }
+
+  void process (const juce::dsp::ProcessContextReplacing<float>& context) noexcept;
+
+  /** Takes one channel's filter state over from another cascade, for a
+      channel that moves from it to this one. Each slot goes on from the
+      state of the same slot there, as across a change of coefficients; in
+      the middle of a transition, from the sections that are being heard.
+      The parallel form's state only carries over between designs of the
+      same shape.
+  */
+  void copyChannelState (const FilterCascade& source, int sourceChannel, int channel) noexcept;
+
+  int getNumActiveSections() const noexcept { return numActive; }
+
+  /** True if the last process() call ran the parallel form. */
+  bool isUsingParallelForm() const noexcept { return processedParallel; }
+
+private:
+  using ChannelState = std::array<BiquadState, numSlots>;
+  using PreciseChannelState = std::array<PreciseBiquadState, numSlots>;
+
+  static_assert (numSlots == ParallelFormDesign::maxSections, "parallel form must fit every slot");
+
+  /** Below this many section-samples per group, waking a worker costs more
+      than it saves.
+  */
+  static constexpr size_t minWorkPerGroup = 16384;
+
+  static constexpr double loudnessSeconds = 1.0;
+  static constexpr double loudnessGatePower = 1.17e-7;   // -70 LUFS
+  static constexpr float maxMakeupDb = 24.f;
+
+  static constexpr double warmUpSeconds = 0.025;
+  static constexpr double warmUpCycles = 2.0;
+  static constexpr double fadeSeconds = 0.01;
+
+  /** Each channel goes through every section one chunk at a time, so however
+      long the host's block is, the samples stay in L1 from one section to the
+      next. A multiple of every kernel's block size, so only the last chunk of
+      a block has a scalar remainder.
+  */
+  static constexpr size_t processChunk = 1024;
+
+  static_assert (processChunk % BlockSectionMatrices::maxBlockSize == 0, "chunks must hold whole kernel blocks");
+
+  // Scratch for one chunk, starting on a cache line like the host's buffers.
+  struct alignas (64) ChunkBuffer
+  {
+    float samples[processChunk];
+  };
+
+  bool isTransitioning() const noexcept { return transitionPosition >= 0; }
+  void beginTransition (const FilterBank& bank) noexcept;
+
+  // start is the chunk's offset in the block, for the gain ramp and the fade.
+  void processTransition (size_t channel, float* samples, size_t numSamples, size_t start) noexcept;
+  void processCascade (size_t channel, float* samples, size_t numSamples, size_t start) noexcept;
+  void processParallelForm (size_t channel, float* samples, size_t numSamples, size_t start) noexcept;
+  LoudnessTap getLoudnessTap (size_t channel, size_t start) noexcept;
+  void updateMakeupGain (size_t numChannels, size_t numSamples) noexcept;
+
+  /** Runs one section in the block kernel, or with exact coefficients, in
+      double precision on those; a tap meters and applies the gain.
+  */
+  void processSection (const BlockSectionMatrices& m, const PreciseBiquadCoefficients* exact,
+                       BiquadState& state, PreciseBiquadState& preciseState, float* samples,
+                       size_t numSamples, LoudnessTap* tap) noexcept;
+
+  const PreciseBiquadCoefficients* getExactCoefficients (size_t slot) const noexcept
+  {
+    return slotPrecise[slot] ? &preciseCoefficients[slot] : nullptr;
+  }
+
+  const PreciseBiquadCoefficients* getSpareCoefficients (size_t index) const noexcept
+  {
+    return sparePrecise[index] ? &spareCoefficients[index] : nullptr;
+  }
+
+  bool setSlot (int slot, const FilterBank& bank);
+  void processChannels (const juce::dsp::AudioBlock<float>& block, size_t begin, size_t end,
+                        bool useParallel, SignalMeters* meters) noexcept;
+  void requestParallelDesign() noexcept;
+  void pullParallelDesign() noexcept;
+
+  const DSPKernels& kernels = DSPKernels::get();
+
+  std::array<BiquadCoefficients, numSlots> coefficients;
+  std::array<PreciseBiquadCoefficients, numSlots> preciseCoefficients;
+  BlockSectionArray blockSections;
+  std::array<bool, numSlots> slotActive {};
+  std::array<bool, numSlots> slotPrecise {};
+  std::array<int, numSlots> activeSlots {};
+  int numActive = 0;
+
+  std::vector<ChannelState> states;
+  std::vector<PreciseChannelState> preciseStates;
+  ChannelWorkerPool* channelWorkers = nullptr;
+  SignalMeters* signalMeters = nullptr;
+  bool hasProcessed = false;
+
+  //==============================================================================
+  /** Matrices that only one form needs at a time: in cascade form the sections
+      being faded out, indexed by slot, and in parallel form the leading
+      sections kept in cascade. Transitions only start in cascade form, and a
+      parallel design is only run after pullParallelDesign() has rewritten
+      this, so sharing it saves a third of the matrices of every instance.
+      The sections that run in double precision keep their coefficients
+      alongside.
+  */
+  BlockSectionArray spareSections;
+  std::array<bool, numSlots> sparePrecise {};
+  std::array<PreciseBiquadCoefficients, numSlots> spareCoefficients;
+
+  //==============================================================================
+  // The sections being faded out, and the output they produce per channel.
+  std::array<int, numSlots> outgoingSlots {};
+  int numOutgoing = 0;
+  std::vector<ChannelState> outgoingStates;
+  std::vector<PreciseChannelState> outgoingPreciseStates;
+  std::vector<ChunkBuffer> outgoingOutput;
+  int warmUpLength = 0, fadeLength = 1;
+  int transitionPosition = -1;
+
+  //==============================================================================
+  double sampleRate = 48000.0;
+  BlockSectionArray meteringSections;    // the K-weighting, then the identity
+  KWeightingMatrices kWeighting;
+  BlockSectionMatrices identitySection;
+  std::vector<std::array<KWeightingState, 2>> loudnessMeters;   // input, output
+  double inputPower = 0, outputPower = 0;
+  bool autoGain = false;
+  float makeupGain = 1.f, targetGain = 1.f;
+
+  // Decided per block before the channels are processed.
+  bool applyingGain = false, metering = false;
+  float gainStep = 0.f;
+
+  //==============================================================================
+  Form form = Form::cascade;
+  bool parallelRequestPending = false;
+  bool parallelReady = false;
+  bool processedParallel = false;
+
+  // Created by startParallelDesigner(); the audio thread only touches it once
+  // designerStarted is set.
+  juce::CriticalSection designerLock;
+  std::unique_ptr<juce::SharedResourcePointer<ParallelFormDesigner>> designer;
+  ParallelFormDesigner::Client designerClient;
+  std::atomic<bool> designerStarted { false };
+
+  ParallelFormLanes parallelSections;
+  int numParallelPrefix = 0;      // leading sections in spareSections
+  std::vector<ChannelState> parallelPrefixStates;
+  std::vector<PreciseChannelState> parallelPrefixPreciseStates;
+  std::vector<ParallelFormLanes::State> parallelStates;
+
+  JUCE_DECLARE_NON_COPYABLE (FilterCascade)
+};
+
+FilterCascade::Form getFilterForm (juce::AudioProcessorValueTreeState& processorParameters);
+
+/** Writes the active, non-identity sections of the bank in processing order
+    and returns how many there are.
+*/
+int getActiveSections (const FilterBank& bank,
+                       std::array<BiquadCoefficients, FilterCascade::numSlots>& sections);
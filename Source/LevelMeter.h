@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+    Peak, energy and stereo cross-product sums of a block, vectorised across
+    samples.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+
+/** What LevelMeterKernel adds up over a block. Index 0 is the left (or only)
+    channel; the right channel's fields and cross stay untouched for mono.
+*/
+struct LevelSums
+{
+  float peak[2] {};
+  double energy[2] {};
+  double cross = 0;
+};
+
+/** One read of each channel gives its peak, its sum of squares and the sum of
+    left * right products from which the correlation follows. Two sets of
+    vector accumulators take alternate vectors, so consecutive multiply-adds
+    do not wait on each other, and they are only reduced once per block.
+
+    SIMDType is expected to behave like juce::dsp::SIMDRegister<float>.
+*/
+template <typename SIMDType>
+struct LevelMeterKernel
+{
+  static constexpr size_t lanes = SIMDType::SIMDNumElements;
+
+  /** Adds the block to sums; right may be nullptr. */
+  static void process (const float* left, const float* right, size_t numSamples, LevelSums& sums) noexcept
+  {
+    Accumulators a, b;
+    size_t n = 0;
+
+    if (right == nullptr)
+    {
+      for (; n + 2 * lanes <= numSamples; n += 2 * lanes)
+      {
+        a.add (left + n);
+        b.add (left + n + lanes);
+      }
+    }
+    else
+    {
+      for (; n + 2 * lanes <= numSamples; n += 2 * lanes)
+      {
+        a.add (left + n, right + n);
+        b.add (left + n + lanes, right + n + lanes);
+      }
+    }
+
+    auto tailPeakL = 0.f, tailPeakR = 0.f, tailEnergyL = 0.f, tailEnergyR = 0.f, tailCross = 0.f;
+
+    for (; n < numSamples; ++n)
+    {
+      const auto l = left[n];
+      tailPeakL = maxOf (tailPeakL, l < 0 ? -l : l);
+      tailEnergyL += l * l;
+
+      if (right != nullptr)
+      {
+        const auto r = right[n];
+        tailPeakR = maxOf (tailPeakR, r < 0 ? -r : r);
+        tailEnergyR += r * r;
+        tailCross += l * r;
+      }
+    }
+
+    sums.peak[0] = maxOf (sums.peak[0], maxOf (tailPeakL, getMaxLane (SIMDType::max (a.peakL, b.peakL))));
+    sums.energy[0] += (double) (a.energyL + b.energyL).sum() + tailEnergyL;
+
+    if (right != nullptr)
+    {
+      sums.peak[1] = maxOf (sums.peak[1], maxOf (tailPeakR, getMaxLane (SIMDType::max (a.peakR, b.peakR))));
+      sums.energy[1] += (double) (a.energyR + b.energyR).sum() + tailEnergyR;
+      sums.cross += (double) (a.cross + b.cross).sum() + tailCross;
+    }
+  }
+
+private:
+  struct Accumulators
+  {
+    SIMDType peakL = SIMDType::expand (0.f), peakR = SIMDType::expand (0.f);
+    SIMDType energyL = SIMDType::expand (0.f), energyR = SIMDType::expand (0.f);
+    SIMDType cross = SIMDType::expand (0.f);
+
+    void add (const float* left) noexcept
+    {
+      const auto l = SIMDType::fromRawArray (left);
+      peakL = SIMDType::max (peakL, SIMDType::abs (l));
+      energyL = SIMDType::multiplyAdd (energyL, l, l);
+    }
+
+    void add (const float* left, const float* right) noexcept
+    {
+      add (left);
+
+      const auto l = SIMDType::fromRawArray (left);
+      const auto r = SIMDType::fromRawArray (right);
+      peakR = SIMDType::max (peakR, SIMDType::abs (r));
+      energyR = SIMDType::multiplyAdd (energyR, r, r);
+      cross = SIMDType::multiplyAdd (cross, l, r);
+    }
+  };
+
+  static float maxOf (float a, float b) noexcept { return a > b ? a : b; }
+
+  static float getMaxLane (SIMDType v) noexcept
+  {
+    alignas (SIMDType) float values[lanes];
+    v.copyToRawArray (values);
+
+    auto result = values[0];
+    for (size_t i = 1; i < lanes; ++i)
+      result = maxOf (result, values[i]);
+
+    return result;
+  }
+};
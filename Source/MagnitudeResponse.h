@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    MagnitudeResponse.h
+    Magnitude, phase and group delay of a biquad cascade, vectorised across
+    frequencies.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockIIR.h"
+
+/** With phi = sin^2 (w / 2), the squared magnitude of b0 + b1 z^-1 + b2 z^-2
+    on the unit circle is the quadratic
+
+        (b0 + b1 + b2)^2 - 4 phi (b1 (b0 + b2) + 4 b0 b2) + 16 b0 b2 phi^2
+
+    so each section costs two quadratics and a division per frequency, with
+    no trigonometry once phi is known. The quadratic coefficients are formed
+    in double to keep the cancellation in 1 + a1 + a2 exact for low poles.
+
+    SIMDType is expected to behave like juce::dsp::SIMDRegister<float>.
+*/
+template <typename SIMDType>
+struct MagnitudeResponseKernel
+{
+  static constexpr size_t lanes = SIMDType::SIMDNumElements;
+
+  /** Writes |H| for each phi; count may be any size. */
+  static void process (const BiquadCoefficients* sections, int numSections,
+                       const float* phi, float* magnitudes, size_t count) noexcept
+  {
+    for (size_t i = 0; i < count; ++i)
+      magnitudes[i] = 1.f;
+
+    for (int s = 0; s < numSections; ++s)
+    {
+      const auto& c = sections[s];
+      float n[3], d[3];
+      quadratic (c.b0, c.b1, c.b2, n);
+      quadratic (1.0, c.a1, c.a2, d);
+
+      const auto n0 = SIMDType::expand (n[0]), n1 = SIMDType::expand (n[1]), n2 = SIMDType::expand (n[2]);
+      const auto d0 = SIMDType::expand (d[0]), d1 = SIMDType::expand (d[1]), d2 = SIMDType::expand (d[2]);
+
+      alignas (SIMDType) float num[lanes], den[lanes];
+      size_t i = 0;
+
+      for (; i + lanes <= count; i += lanes)
+      {
+        const auto x = SIMDType::fromRawArray (phi + i);
+        SIMDType::multiplyAdd (n0, x, SIMDType::multiplyAdd (n1, x, n2)).copyToRawArray (num);
+        SIMDType::multiplyAdd (d0, x, SIMDType::multiplyAdd (d1, x, d2)).copyToRawArray (den);
+
+        for (size_t k = 0; k < lanes; ++k)
+          magnitudes[i + k] *= num[k] / den[k];
+      }
+
+      for (; i < count; ++i)
+        magnitudes[i] *= (n[0] + phi[i] * (n[1] + phi[i] * n[2]))
+                       / (d[0] + phi[i] * (d[1] + phi[i] * d[2]));
+    }
+
+    for (size_t i = 0; i < count; ++i)
+      magnitudes[i] = __builtin_sqrtf (magnitudes[i] > 0.f ? magnitudes[i] : 0.f);
+  }
+
+private:
+  static void quadratic (double b0, double b1, double b2, float* q) noexcept
+  {
+    q[0] = (float) ((b0 + b1 + b2) * (b0 + b1 + b2));
+    q[1] = (float) (-4.0 * (b1 * (b0 + b2) + 4.0 * b0 * b2));
+    q[2] = (float) (16.0 * b0 * b2);
+  }
+};
+
+//==============================================================================
+/** The complex response of each section, written with phi = sin^2 (w / 2)
+    and sin w so that, as above, the terms that cancel near DC are formed in
+    double once per section:
+
+        Re B  = (b0 + b1 + b2) - phi (2 b1 + 8 b2) + 8 b2 phi^2
+        Im B  = -sin w ((b1 + 2 b2) - 4 b2 phi)
+
+    The group delay of B in samples is Re (B' / B), with B' = sum k b_k z^-k:
+
+        Re B' = (b1 + 2 b2) - phi (2 b1 + 16 b2) + 16 b2 phi^2
+        Im B' = -sin w ((b1 + 4 b2) - 8 b2 phi)
+
+    The same holds for the denominator A with b = (1, a1, a2). The sections'
+    responses are multiplied as complex numbers, so the phase needs a single
+    atan2 per frequency, and their group delays are summed.
+
+    SIMDType must also provide operator- and operator/ (see FloatLanes).
+*/
+template <typename SIMDType>
+struct FrequencyResponseKernel
+{
+  static constexpr size_t lanes = SIMDType::SIMDNumElements;
+
+  /** Writes |H|, arg H in radians wrapped to (-pi, pi] and the group delay in
+      samples for each (phi, sin w) pair. Any output may be nullptr; count may
+      be any size.
+  */
+  static void process (const BiquadCoefficients* sections, int numSections,
+                       const float* phi, const float* sinOmega,
+                       float* magnitudes, float* phases, float* groupDelays, size_t count) noexcept
+  {
+    alignas (SIMDType) float re[lanes], im[lanes], delay[lanes];
+    alignas (SIMDType) float phiLanes[lanes], sinLanes[lanes];
+
+    for (size_t i = 0; i < count; i += lanes)
+    {
+      const auto n = count - i < lanes ? count - i : lanes;
+
+      // Short tails are padded with DC, whose response is always finite.
+      for (size_t k = 0; k < lanes; ++k)
+      {
+        phiLanes[k] = k < n ? phi[i + k] : 0.f;
+        sinLanes[k] = k < n ? sinOmega[i + k] : 0.f;
+      }
+
+      const auto x = SIMDType::fromRawArray (phiLanes);
+      const auto s = SIMDType::fromRawArray (sinLanes);
+
+      auto hRe = SIMDType::expand (1.f), hIm = SIMDType::expand (0.f), tau = SIMDType::expand (0.f);
+
+      for (int sec = 0; sec < numSections; ++sec)
+      {
+        const auto& c = sections[sec];
+        Polynomial b, a;
+        b.set (c.b0, c.b1, c.b2);
+        a.set (1.0, c.a1, c.a2);
+
+        SIMDType bRe, bIm, aRe, aIm;
+        tau = tau + b.evaluate (x, s, bRe, bIm) - a.evaluate (x, s, aRe, aIm);
+
+        // h *= B conj (A) / |A|^2
+        const auto aNorm = aRe * aRe + aIm * aIm;
+        const auto rRe = (bRe * aRe + bIm * aIm) / aNorm;
+        const auto rIm = (bIm * aRe - bRe * aIm) / aNorm;
+
+        const auto newRe = hRe * rRe - hIm * rIm;
+        hIm = hRe * rIm + hIm * rRe;
+        hRe = newRe;
+      }
+
+      hRe.copyToRawArray (re);
+      hIm.copyToRawArray (im);
+      tau.copyToRawArray (delay);
+
+      for (size_t k = 0; k < n; ++k)
+      {
+        if (magnitudes != nullptr)  magnitudes[i + k] = __builtin_sqrtf (re[k] * re[k] + im[k] * im[k]);
+        if (phases != nullptr)      phases[i + k] = __builtin_atan2f (im[k], re[k]);
+        if (groupDelays != nullptr) groupDelays[i + k] = delay[k];
+      }
+    }
+  }
+
+private:
+  struct Polynomial
+  {
+    float re[3], im[2], dRe[3], dIm[2];
+
+    void set (double b0, double b1, double b2) noexcept
+    {
+      re[0] = (float) (b0 + b1 + b2);   re[1] = (float) (-(2.0 * b1 + 8.0 * b2));   re[2] = (float) (8.0 * b2);
+      im[0] = (float) -(b1 + 2.0 * b2); im[1] = (float) (4.0 * b2);
+      dRe[0] = (float) (b1 + 2.0 * b2); dRe[1] = (float) (-(2.0 * b1 + 16.0 * b2)); dRe[2] = (float) (16.0 * b2);
+      dIm[0] = (float) -(b1 + 4.0 * b2); dIm[1] = (float) (8.0 * b2);
+    }
+
+    /** Writes the polynomial's value and returns its group delay. */
+    SIMDType evaluate (SIMDType x, SIMDType s, SIMDType& valueRe, SIMDType& valueIm) const noexcept
+    {
+      valueRe = SIMDType::multiplyAdd (SIMDType::expand (re[0]), x,
+                                       SIMDType::multiplyAdd (SIMDType::expand (re[1]), x, SIMDType::expand (re[2])));
+      valueIm = s * SIMDType::multiplyAdd (SIMDType::expand (im[0]), x, SIMDType::expand (im[1]));
+
+      const auto derivativeRe = SIMDType::multiplyAdd (SIMDType::expand (dRe[0]), x,
+                                                       SIMDType::multiplyAdd (SIMDType::expand (dRe[1]), x, SIMDType::expand (dRe[2])));
+      const auto derivativeIm = s * SIMDType::multiplyAdd (SIMDType::expand (dIm[0]), x, SIMDType::expand (dIm[1]));
+
+      // Zeros on the unit circle (the cut filters' at DC and Nyquist) would
+      // divide by zero exactly there; they contribute no delay instead.
+      const auto norm = valueRe * valueRe + valueIm * valueIm + SIMDType::expand (1.0e-30f);
+      return (derivativeRe * valueRe + derivativeIm * valueIm) / norm;
+    }
+  };
+};
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    MatchedDesign.cpp
+    Second order sections whose magnitude follows the analog prototype up to
+    Nyquist, instead of cramping like the bilinear transform.
+
+  ==============================================================================
+*/
+
+#include "MatchedDesign.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  constexpr double pi = 3.14159265358979323846;
+
+  /** Analog |H(j w)|^2 of a normalised second order section, w in units of w0. */
+  struct AnalogSection
+  {
+    double numS2, numS1, numS0;   // numerator  numS2 s^2 + numS1 s + numS0
+    double poleQ;                 // denominator s^2 + s / poleQ + 1
+
+    double magnitudeSquared (double w) const noexcept
+    {
+      const auto w2 = w * w;
+      const auto nRe = numS0 - numS2 * w2, nIm = numS1 * w;
+      const auto dRe = 1.0 - w2, dIm = w / poleQ;
+      return (nRe * nRe + nIm * nIm) / (dRe * dRe + dIm * dIm);
+    }
+  };
+
+  PreciseBiquadCoefficients designMatched (double sampleRate, double frequency, const AnalogSection& analog)
+  {
+    const auto w0 = 2.0 * pi * std::min (frequency, 0.499 * sampleRate) / sampleRate;
+
+    // Impulse-invariant poles.
+    const auto zeta = 1.0 / (2.0 * analog.poleQ);
+    const auto decay = std::exp (-zeta * w0);
+    const auto a1 = zeta <= 1.0 ? -2.0 * decay * std::cos (w0 * std::sqrt (1.0 - zeta * zeta))
+                                : -2.0 * decay * std::cosh (w0 * std::sqrt (zeta * zeta - 1.0));
+    const auto a2 = decay * decay;
+
+    // |H|^2 = (B0 f0 + B1 f1 + B2 f2) / (A0 f0 + A1 f1 + A2 f2) with
+    // f1 = sin^2 (w / 2), f0 = 1 - f1 and f2 = 4 f0 f1.
+    const auto A0 = (1.0 + a1 + a2) * (1.0 + a1 + a2);
+    const auto A1 = (1.0 - a1 + a2) * (1.0 - a1 + a2);
+    const auto A2 = -4.0 * a2;
+
+    const auto f1 = std::pow (std::sin (0.5 * w0), 2.0);
+    const auto f0 = 1.0 - f1;
+    const auto f2 = 4.0 * f0 * f1;
+
+    const auto target = analog.magnitudeSquared (1.0) * (A0 * f0 + A1 * f1 + A2 * f2);
+
+    // A pure s^2 numerator keeps its double zero at DC, b (1 - z^-1)^2, and is
+    // matched at the centre frequency only.
+    if (analog.numS1 == 0.0 && analog.numS0 == 0.0)
+    {
+      const auto b0 = std::sqrt (target) / (4.0 * f1);
+      return { b0, -2.0 * b0, b0, a1, a2 };
+    }
+
+    const auto B0 = A0 * analog.magnitudeSquared (0.0);
+    const auto B1 = A1 * analog.magnitudeSquared (pi / w0);
+    const auto B2 = (target - B0 * f0 - B1 * f1) / f2;
+
+    const auto sqrtB0 = std::sqrt (B0), sqrtB1 = std::sqrt (B1);
+    const auto W = 0.5 * (sqrtB0 + sqrtB1);
+    const auto b0 = 0.5 * (W + std::sqrt (std::max (W * W + B2, 0.0)));
+    const auto b1 = 0.5 * (sqrtB0 - sqrtB1);
+    const auto b2 = b0 > 0.0 ? -B2 / (4.0 * b0) : 0.0;
+
+    return { b0, b1, b2, a1, a2 };
+  }
+}
+
+PreciseBiquadCoefficients designMatchedPeak (double sampleRate, double frequency, double q, double gainFactor)
+{
+  // Same prototype as the RBJ peak: (s^2 + s A/Q + 1) / (s^2 + s/(A Q) + 1), A^2 = gain.
+  const auto A = std::sqrt (gainFactor);
+  return designMatched (sampleRate, frequency, { 1.0, A / q, 1.0, A * q });
+}
+
+PreciseBiquadCoefficients designMatchedLowPass (double sampleRate, double frequency, double q)
+{
+  return designMatched (sampleRate, frequency, { 0.0, 0.0, 1.0, q });
+}
+
+PreciseBiquadCoefficients designMatchedHighPass (double sampleRate, double frequency, double q)
+{
+  return designMatched (sampleRate, frequency, { 1.0, 0.0, 0.0, q });
+}
@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+
+    MatchedDesign.h
+    Second order sections whose magnitude follows the analog prototype up to
+    Nyquist, instead of cramping like the bilinear transform.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockIIR.h"
+
+/** After M. Vicanek, "Matched Second Order Digital Filters" (2016): the poles
+    are the impulse-invariant images of the analog poles, and the numerator is
+    solved so that |H|^2 equals the analog |H|^2 exactly at DC, at the centre
+    frequency and at Nyquist. In between the error stays small even when the
+    centre frequency is close to Nyquist. The sections are returned in double
+    precision.
+
+    Frequencies are given in Hz; they are limited to just below Nyquist.
+*/
+PreciseBiquadCoefficients designMatchedPeak (double sampleRate, double frequency, double q, double gainFactor);
+PreciseBiquadCoefficients designMatchedLowPass (double sampleRate, double frequency, double q);
+PreciseBiquadCoefficients designMatchedHighPass (double sampleRate, double frequency, double q);
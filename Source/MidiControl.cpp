@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    MidiControl.cpp
+    MIDI CC learn and mapping for the parameters the editor has knobs for.
+
+  ==============================================================================
+*/
+
+#include "MidiControl.h"
+
+const juce::Identifier MidiControl::stateType ("MidiControl");
+
+MidiControl::MidiControl()
+{
+  for (auto& parameter : controllerToParameter)
+    parameter.store (-1);
+}
+
+const std::array<juce::String, MidiControl::numLearnable>& MidiControl::getLearnableParameterIDs()
+{
+  static const std::array<juce::String, numLearnable> ids { "hpFreq", "hpSlope", "lpFreq", "lpSlope",
+                                                            "peakGain1", "peakFreq1", "peakQ1",
+                                                            "peakGain2", "peakFreq2", "peakQ2",
+                                                            "peakGain3", "peakFreq3", "peakQ3",
+                                                            "morph" };
+  return ids;
+}
+
+void MidiControl::attach (juce::AudioProcessorValueTreeState& state)
+{
+  for (size_t i = 0; i < parameters.size(); ++i)
+  {
+    parameters[i] = state.getParameter (getLearnableParameterIDs()[i]);
+    jassert (parameters[i] != nullptr);
+  }
+}
+
+void MidiControl::forget (int parameterIndex) noexcept
+{
+  for (auto& parameter : controllerToParameter)
+  {
+    auto expected = parameterIndex;
+    parameter.compare_exchange_strong (expected, -1);
+  }
+}
+
+int MidiControl::getController (int parameterIndex) const noexcept
+{
+  for (size_t controller = 0; controller < controllerToParameter.size(); ++controller)
+    if (controllerToParameter[controller].load() == parameterIndex)
+      return (int) controller;
+
+  return -1;
+}
+
+bool MidiControl::isMapped (const juce::MidiMessage& message) const noexcept
+{
+  return message.isController()
+      && (learning.load() >= 0 || controllerToParameter[(size_t) message.getControllerNumber()].load() >= 0);
+}
+
+bool MidiControl::handle (const juce::MidiMessage& message) noexcept
+{
+  if (! message.isController())
+    return false;
+
+  const auto controller = (size_t) message.getControllerNumber();
+
+  if (const auto target = learning.exchange (-1); target >= 0)
+  {
+    forget (target);
+    controllerToParameter[controller].store (target);
+  }
+
+  const auto index = controllerToParameter[controller].load();
+
+  if (index < 0 || parameters[(size_t) index] == nullptr)
+    return false;
+
+  // Changes from the audio thread reach the host and the editor's listeners
+  // like automation does; the raw value the next redesign reads is set at once.
+  parameters[(size_t) index]->setValueNotifyingHost ((float) message.getControllerValue() / 127.f);
+  return true;
+}
+
+juce::ValueTree MidiControl::toValueTree() const
+{
+  juce::ValueTree tree (stateType);
+
+  for (int i = 0; i < numLearnable; ++i)
+    if (const auto controller = getController (i); controller >= 0)
+      tree.setProperty (getLearnableParameterIDs()[(size_t) i], controller, nullptr);
+
+  return tree;
+}
+
+void MidiControl::fromValueTree (const juce::ValueTree& tree)
+{
+  for (auto& parameter : controllerToParameter)
+    parameter.store (-1);
+
+  for (int i = 0; i < numLearnable; ++i)
+  {
+    const auto controller = (int) tree.getProperty (getLearnableParameterIDs()[(size_t) i], -1);
+
+    if (juce::isPositiveAndBelow (controller, (int) controllerToParameter.size()))
+      controllerToParameter[(size_t) controller].store (i);
+  }
+}
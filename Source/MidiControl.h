@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    MidiControl.h
+    MIDI CC learn and mapping for the parameters the editor has knobs for.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Each of the 128 controller numbers drives at most one learnable parameter,
+    on any MIDI channel, across the parameter's whole range.
+
+    The mapping is a table of atomics: the message thread arms learning or
+    forgets a mapping, and the audio thread reads the table and completes a
+    learn with the next controller it sees, without either side locking.
+*/
+class MidiControl
+{
+public:
+  static constexpr int numLearnable = 14;
+
+  MidiControl();
+
+  /** hpFreq, hpSlope, lpFreq, lpSlope, the gain, frequency and Q of the
+      first three bands, and the morph.
+  */
+  static const std::array<juce::String, numLearnable>& getLearnableParameterIDs();
+
+  /** Looks the learnable parameters up; call once the state exists. */
+  void attach (juce::AudioProcessorValueTreeState& state);
+
+  //==============================================================================
+  /** The next controller that arrives is mapped to this parameter, replacing
+      any mapping either had.
+  */
+  void learn (int parameterIndex) noexcept     { learning.store (parameterIndex); }
+  void cancelLearning() noexcept               { learning.store (-1); }
+  bool isLearning (int parameterIndex) const noexcept { return learning.load() == parameterIndex; }
+
+  void forget (int parameterIndex) noexcept;
+
+  /** The controller number mapped to the parameter, or -1. */
+  int getController (int parameterIndex) const noexcept;
+
+  //==============================================================================
+  /** True if handle() would act on the message: a mapped controller, or any
+      controller while learning.
+  */
+  bool isMapped (const juce::MidiMessage& message) const noexcept;
+
+  /** Audio thread: completes a pending learn and moves the mapped parameter.
+      Returns true if a parameter was set.
+  */
+  bool handle (const juce::MidiMessage& message) noexcept;
+
+  //==============================================================================
+  static const juce::Identifier stateType;
+
+  juce::ValueTree toValueTree() const;
+  void fromValueTree (const juce::ValueTree& tree);
+
+private:
+  std::array<std::atomic<int>, 128> controllerToParameter;
+  std::atomic<int> learning { -1 };
+  std::array<juce::RangedAudioParameter*, numLearnable> parameters {};
+
+  JUCE_DECLARE_NON_COPYABLE (MidiControl)
+};
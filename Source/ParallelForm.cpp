@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    ParallelForm.cpp
+    Partial-fraction conversion of a biquad cascade into a sum of
+    independent second order sections, evaluated side by side in SIMD lanes.
+
+  ==============================================================================
+*/
+
+#include "ParallelForm.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace
+{
+  using Complex = std::complex<double>;
+
+  // Evaluates b0 + b1 w + b2 w^2 with w = z^-1.
+  Complex evalQuadratic (double c0, double c1, double c2, Complex w)
+  {
+    return c0 + w * (c1 + w * c2);
+  }
+
+  Complex cascadeResponse (const PreciseBiquadCoefficients* cascade, int numSections, Complex w)
+  {
+    Complex h { 1.0, 0.0 };
+
+    for (int i = 0; i < numSections; ++i)
+    {
+      const auto& c = cascade[i];
+      h *= evalQuadratic (c.b0, c.b1, c.b2, w) / evalQuadratic (1.0, c.a1, c.a2, w);
+    }
+
+    return h;
+  }
+
+  Complex parallelResponse (const ParallelFormDesign& design, Complex w)
+  {
+    Complex h { design.direct, 0.0 };
+
+    for (int i = 0; i < design.numSections; ++i)
+    {
+      const auto& s = design.sections[(size_t) i];
+      h += evalQuadratic (s.c0, s.c1, 0.0, w) / evalQuadratic (1.0, s.a1, s.a2, w);
+    }
+
+    return h;
+  }
+
+  bool expand (const PreciseBiquadCoefficients* cascade, int numSections,
+               ParallelFormDesign& design, double maxRelativeError)
+  {
+    constexpr double minPoleRadius = 1.0e-9, minPoleDistance = 1.0e-7;
+
+    std::array<Complex, 2 * ParallelFormDesign::maxSections> poles;
+    const auto numPoles = 2 * numSections;
+
+    for (int i = 0; i < numSections; ++i)
+    {
+      const auto& c = cascade[i];
+      const auto root = std::sqrt (Complex (c.a1 * c.a1 - 4.0 * c.a2, 0.0));
+      poles[(size_t) (2 * i)]     = 0.5 * (-c.a1 + root);
+      poles[(size_t) (2 * i + 1)] = 0.5 * (-c.a1 - root);
+    }
+
+    for (int i = 0; i < numPoles; ++i)
+    {
+      if (std::abs (poles[(size_t) i]) < minPoleRadius)
+        return false;
+
+      for (int j = i + 1; j < numPoles; ++j)
+        if (std::abs (poles[(size_t) i] - poles[(size_t) j]) < minPoleDistance)
+          return false;
+    }
+
+    // H(w) = k + sum_i r_i / (1 - p_i w), with k the ratio of the w^2n coefficients.
+    double direct = 1.0;
+    for (int i = 0; i < numSections; ++i)
+      direct *= cascade[i].b2 / cascade[i].a2;
+
+    std::array<Complex, 2 * ParallelFormDesign::maxSections> residues;
+
+    for (int i = 0; i < numPoles; ++i)
+    {
+      const auto p = poles[(size_t) i];
+      const auto w = 1.0 / p;
+
+      Complex num { 1.0, 0.0 }, den { 1.0, 0.0 };
+      for (int s = 0; s < numSections; ++s)
+        num *= evalQuadratic (cascade[s].b0, cascade[s].b1, cascade[s].b2, w);
+
+      for (int j = 0; j < numPoles; ++j)
+        if (j != i)
+          den *= 1.0 - poles[(size_t) j] * w;
+
+      residues[(size_t) i] = num / den;
+    }
+
+    // Recombine each section's pole pair (complex conjugate or two real poles)
+    // into one real second order section with a first order numerator.
+    for (int i = 0; i < numSections; ++i)
+    {
+      const auto p1 = poles[(size_t) (2 * i)], p2 = poles[(size_t) (2 * i + 1)];
+      const auto r1 = residues[(size_t) (2 * i)], r2 = residues[(size_t) (2 * i + 1)];
+
+      auto& s = design.sections[(size_t) i];
+      s.c0 = (float) (r1 + r2).real();
+      s.c1 = (float) -(r1 * p2 + r2 * p1).real();
+      s.a1 = (float) cascade[i].a1;
+      s.a2 = (float) cascade[i].a2;
+    }
+
+    design.numSections = numSections;
+    design.direct = (float) direct;
+
+    constexpr int numCheckPoints = 64;
+    constexpr double floorMagnitude = 1.0e-3;
+    const auto pi = std::acos (-1.0);
+
+    for (int i = 0; i < numCheckPoints; ++i)
+    {
+      // Log-spaced from about 2 Hz at 48 kHz up to Nyquist.
+      const auto omega = pi * std::pow (1.0e-4, 1.0 - i / double (numCheckPoints - 1));
+      const auto w = std::polar (1.0, -omega);
+
+      const auto reference = cascadeResponse (cascade, numSections, w);
+      const auto error = std::abs (parallelResponse (design, w) - reference);
+
+      if (! (error <= maxRelativeError * std::max (std::abs (reference), floorMagnitude)))
+      {
+        design.numSections = 0;
+        design.direct = 1;
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
+
+bool designParallelForm (const PreciseBiquadCoefficients* cascade, int numSections,
+                         ParallelFormDesign& design, double maxRelativeError)
+{
+  design.valid = false;
+  design.numSections = 0;
+  design.numCascadeSections = 0;
+  design.direct = 1;
+
+  if (numSections > ParallelFormDesign::maxSections)
+    return false;
+
+  for (int first = 0; first < numSections; ++first)
+  {
+    if (expand (cascade + first, numSections - first, design, maxRelativeError))
+    {
+      for (int i = 0; i < first; ++i)
+        design.cascadeSections[(size_t) i] = cascade[i];
+
+      design.numCascadeSections = first;
+      design.valid = true;
+      return true;
+    }
+  }
+
+  design.numCascadeSections = numSections;
+  design.valid = numSections == 0;
+  return design.valid;
+}
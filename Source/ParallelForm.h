@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    ParallelForm.h
+    Partial-fraction conversion of a biquad cascade into a sum of
+    independent second order sections, evaluated side by side in SIMD lanes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "BlockIIR.h"
+#include <array>
+
+/** H(z) = C(z) * (direct + sum_k (c0 + c1 z^-1) / (1 + a1 z^-1 + a2 z^-2)),
+    where C(z) is the leading numCascadeSections of the original cascade that
+    could not be expanded accurately (typically low high-pass sections, whose
+    DC zeros a float parallel sum cannot reproduce). They keep their double
+    coefficients, so the ones needsDoublePrecision() picks run in double as
+    they do in the cascade.
+*/
+struct ParallelFormDesign
+{
+  static constexpr int maxSections = 32;
+
+  struct Section
+  {
+    float c0{0}, c1{0}, a1{0}, a2{0};
+  };
+
+  std::array<Section, maxSections> sections {};
+  std::array<PreciseBiquadCoefficients, maxSections> cascadeSections {};
+  int numSections = 0;
+  int numCascadeSections = 0;
+  float direct = 1;
+  bool valid = false;
+};
+
+/** Expands the cascade into parallel form. A suffix of the cascade is only
+    accepted if its poles are distinct and away from the origin, and if the
+    float parallel response stays within maxRelativeError of the response of
+    the unrounded cascade from DC to Nyquist; otherwise one more leading section is kept in
+    cascade form and the rest is tried again. Returns false, leaving
+    design.valid unset, if no suffix qualifies.
+*/
+bool designParallelForm (const PreciseBiquadCoefficients* cascade, int numSections,
+                         ParallelFormDesign& design,
+                         double maxRelativeError = 1.0e-3);
+
+//==============================================================================
+/** A ParallelFormDesign packed one section per lane, padded with zero
+    sections to the widest supported register.
+*/
+struct ParallelFormLanes
+{
+  static constexpr size_t maxLanes = 32;
+  static_assert (ParallelFormDesign::maxSections <= (int) maxLanes, "sections must fit the lanes");
+
+  alignas (64) float c0[maxLanes] {};
+  alignas (64) float c1[maxLanes] {};
+  alignas (64) float negA1[maxLanes] {};
+  alignas (64) float negA2[maxLanes] {};
+  int numSections = 0;
+  float direct = 1;
+
+  struct State
+  {
+    alignas (64) float s1[maxLanes] {};
+    alignas (64) float s2[maxLanes] {};
+
+    void reset() noexcept
+    {
+      for (size_t i = 0; i < maxLanes; ++i)
+        s1[i] = s2[i] = 0;
+    }
+  };
+
+  void setDesign (const ParallelFormDesign& design) noexcept
+  {
+    for (size_t i = 0; i < maxLanes; ++i)
+    {
+      const auto used = (int) i < design.numSections;
+      const auto& s = design.sections[used ? i : 0];
+      c0[i] = used ? s.c0 : 0.f;
+      c1[i] = used ? s.c1 : 0.f;
+      negA1[i] = used ? -s.a1 : 0.f;
+      negA2[i] = used ? -s.a2 : 0.f;
+    }
+
+    numSections = design.numSections;
+    direct = design.direct;
+  }
+};
+
+/** Runs a ParallelFormLanes with one section per SIMD lane. Unused lanes hold
+    zero coefficients and contribute nothing to the sum.
+
+    The recursion only adds the groups of lanes together and stores each
+    sample's lane sums; the sums across the lanes are taken afterwards for
+    reduceChunk samples at a time, so the horizontal add, a chain of shuffles,
+    is not repeated inside the per-sample loop.
+
+    SIMDType is expected to behave like juce::dsp::SIMDRegister<float>.
+*/
+template <typename SIMDType>
+struct ParallelFormKernel
+{
+  static constexpr size_t lanes = SIMDType::SIMDNumElements;
+  static constexpr size_t maxGroups = ParallelFormLanes::maxLanes / lanes;
+  static constexpr size_t reduceChunk = 64;
+
+  static void process (const ParallelFormLanes& p, ParallelFormLanes::State& state,
+                       float* samples, size_t numSamples) noexcept
+  {
+    const auto numGroups = ((size_t) p.numSections + lanes - 1) / lanes;
+
+    SIMDType c0[maxGroups], c1[maxGroups], negA1[maxGroups], negA2[maxGroups];
+    SIMDType s1[maxGroups], s2[maxGroups];
+
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+      c0[g] = SIMDType::fromRawArray (p.c0 + g * lanes);
+      c1[g] = SIMDType::fromRawArray (p.c1 + g * lanes);
+      negA1[g] = SIMDType::fromRawArray (p.negA1 + g * lanes);
+      negA2[g] = SIMDType::fromRawArray (p.negA2 + g * lanes);
+      s1[g] = SIMDType::fromRawArray (state.s1 + g * lanes);
+      s2[g] = SIMDType::fromRawArray (state.s2 + g * lanes);
+    }
+
+    alignas (64) float laneSums[reduceChunk * lanes];
+
+    for (size_t start = 0; start < numSamples; start += reduceChunk)
+    {
+      const auto length = std::min (reduceChunk, numSamples - start);
+      auto* chunk = samples + start;
+
+      for (size_t i = 0; i < length; ++i)
+      {
+        const auto x = SIMDType::expand (chunk[i]);
+        auto sum = SIMDType::expand (0.f);
+
+        for (size_t g = 0; g < numGroups; ++g)
+        {
+          const auto y = SIMDType::multiplyAdd (s1[g], c0[g], x);
+          s1[g] = SIMDType::multiplyAdd (SIMDType::multiplyAdd (s2[g], c1[g], x), negA1[g], y);
+          s2[g] = negA2[g] * y;
+          sum = sum + y;
+        }
+
+        sum.copyToRawArray (laneSums + i * lanes);
+      }
+
+      for (size_t i = 0; i < length; ++i)
+      {
+        auto total = p.direct * chunk[i];
+
+        for (size_t lane = 0; lane < lanes; ++lane)
+          total += laneSums[i * lanes + lane];
+
+        chunk[i] = total;
+      }
+    }
+
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+      s1[g].copyToRawArray (state.s1 + g * lanes);
+      s2[g].copyToRawArray (state.s2 + g * lanes);
+    }
+  }
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    ParallelFormDesigner.cpp
+    Background thread that expands cascades into parallel form on behalf of
+    every plugin instance in the process.
+
+  ==============================================================================
+*/
+
+#include "ParallelFormDesigner.h"
+#include "Trace.h"
+
+ParallelFormDesigner::ParallelFormDesigner() : juce::Thread ("EQ5b parallel form designer")
+{
+  startThread (juce::Thread::Priority::low);
+}
+
+ParallelFormDesigner::~ParallelFormDesigner()
+{
+  stopThread (1000);
+}
+
+void ParallelFormDesigner::addClient (Client& client)
+{
+  const juce::ScopedLock sl (clientLock);
+
+  if (clients.addIfNotAlreadyThere (&client))
+    client.registration = ++numRegistrations;
+}
+
+void ParallelFormDesigner::removeClient (Client& client)
+{
+  // Waits for a request being taken from, or a design being handed to, this
+  // client; a design in progress is dropped when it finishes.
+  const juce::ScopedLock sl (clientLock);
+  clients.removeAllInstancesOf (&client);
+}
+
+void ParallelFormDesigner::run()
+{
+  while (! threadShouldExit())
+  {
+    {
+      const juce::ScopedLock sl (clientLock);
+      pending.clearQuick();
+
+      for (auto* client : clients)
+        pending.add ({ client, client->registration });
+    }
+
+    for (const auto& entry : pending)
+    {
+      auto* client = entry.first;
+
+      const auto isRegistered = [this, &entry]
+      {
+        return clients.contains (entry.first) && entry.first->registration == entry.second;
+      };
+
+      {
+        const juce::ScopedLock sl (clientLock);
+
+        if (! isRegistered() || ! client->requests.pull())
+          continue;
+
+        request = client->requests.getReadBuffer();
+      }
+
+      {
+        EQ5B_TRACE_SCOPE ("designParallelForm");
+        designParallelForm (request.sections.data(), request.numSections, design);
+      }
+
+      const juce::ScopedLock sl (clientLock);
+
+      if (isRegistered())
+      {
+        client->results.getWriteBuffer() = design;
+        client->results.publish();
+      }
+    }
+
+    wait (-1);
+  }
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    ParallelFormDesigner.h
+    Background thread that expands cascades into parallel form on behalf of
+    every plugin instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParallelForm.h"
+#include "TripleBuffer.h"
+
+/** Held through a juce::SharedResourcePointer, so all instances share one
+    thread. Each FilterCascade owns a Client: the audio thread publishes the
+    active sections into requests and calls wakeUp(), and picks up finished
+    designs from results at the start of a later block.
+
+    The client list is only locked to take a request and to hand over its
+    design, not while designing, so adding or removing a client never waits
+    for a design of another.
+*/
+class ParallelFormDesigner : private juce::Thread
+{
+public:
+  struct Request
+  {
+    std::array<PreciseBiquadCoefficients, ParallelFormDesign::maxSections> sections {};
+    int numSections = 0;
+  };
+
+  struct Client
+  {
+    TripleBuffer<Request> requests;
+    TripleBuffer<ParallelFormDesign> results;
+
+    // Set by addClient(), so that a design is never handed to another client
+    // added at the address of a removed one.
+    juce::uint32 registration = 0;
+  };
+
+  ParallelFormDesigner();
+  ~ParallelFormDesigner() override;
+
+  void addClient (Client& client);
+  void removeClient (Client& client);
+
+  void wakeUp() noexcept { notify(); }
+
+private:
+  void run() override;
+
+  juce::CriticalSection clientLock;
+  juce::Array<Client*> clients;
+  juce::uint32 numRegistrations = 0;
+
+  // Designer thread only.
+  juce::Array<std::pair<Client*, juce::uint32>> pending;
+  Request request;
+  ParallelFormDesign design;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParallelFormDesigner)
+};
@@ -8,19 +8,27 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "FilterCascade.h"
+#include "SnapshotMorph.h"
 
 ResponseCurveComponent::ResponseCurveComponent(EQ5bAudioProcessor& p) : audioProcessor(p)
 {
+  setOpaque(true);
+
   const auto& params = audioProcessor.getParameters();
   for (auto param : params) 
   {
     param->addListener(this);
   };
+
+  parametersChanged.set(true);
   startTimerHz(60);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+    cancelPendingUpdate();
+
     const auto& params = audioProcessor.getParameters();
     for (auto param : params) 
     {
@@ -31,110 +39,294 @@ ResponseCurveComponent::~ResponseCurveComponent()
 void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue)
 {
   parametersChanged.set(true);
+
+  // Changes can come from the audio thread, which must not touch the timer.
+  if (juce::MessageManager::existsAndIsCurrentThread())
+    handleAsyncUpdate();
+  else
+    triggerAsyncUpdate();
+}
+
+void ResponseCurveComponent::handleAsyncUpdate()
+{
+  idleTicks = 0;
+
+  if (! isTimerRunning())
+    startTimerHz(60);
 }
 
 void ResponseCurveComponent::timerCallback()
 {
   if(parametersChanged.compareAndSetBool(false,true))
   {
+    EQ5B_TRACE_SCOPE("ResponseCurveComponent::timerCallback");
+
     auto chainSettings = getChainSettings(audioProcessor.processorParameters);
     double sampleRate = audioProcessor.getSampleRate();
 
-    auto hpCoeff = makeHpFilter(chainSettings.hpFilter, sampleRate);
-    updateCutFiltersSlope(monoChain.get<ChainPositions::HiPass>(), hpCoeff, chainSettings.hpFilter.slope);
-    auto peak1Coeff = makePeakFilter(chainSettings.loPeak, sampleRate);
-    updateCoefficients(monoChain.get<ChainPositions::LoPeak>().coefficients, peak1Coeff);
-    auto peak2Coeff = makePeakFilter(chainSettings.midPeak, sampleRate);
-    updateCoefficients(monoChain.get<ChainPositions::MidPeak>().coefficients, peak2Coeff);
-    auto peak3Coeff = makePeakFilter(chainSettings.hiPeak, sampleRate);
-    updateCoefficients(monoChain.get<ChainPositions::HiPeak>().coefficients, peak3Coeff);
-    auto lpCoeff = makeLpFilter(chainSettings.lpFilter, sampleRate);
-    updateCutFiltersSlope(monoChain.get<ChainPositions::LoPass>(), lpCoeff, chainSettings.lpFilter.slope);
+    updateFilterBank(filterBank, chainSettings, sampleRate);
+    updateResponseCurve();
 
-    repaint();
+    idleTicks = 0;
+  }
+  else if (++idleTicks >= idleTicksBeforeSleeping)
+  {
+    stopTimer();
   }
 }
-void ResponseCurveComponent::paint (juce::Graphics& g)
+
+void ResponseCurveComponent::updateResponseCurve()
 {
   using namespace juce;
-  // (Our component is opaque, so we must completely fill the background with a solid colour)
-  g.fillAll (Colours::black);
 
-  auto responseArea = getLocalBounds();
-  auto w = responseArea.getWidth();
+  const auto responseArea = getLocalBounds();
+  const auto w = (int) mags.size();
 
-  auto& hpFilter = monoChain.get<ChainPositions::HiPass>();
-  auto& peak1 = monoChain.get<ChainPositions::LoPeak>();
-  auto& peak2 = monoChain.get<ChainPositions::MidPeak>();
-  auto& peak3 = monoChain.get<ChainPositions::HiPeak>();
-  auto& lpFilter = monoChain.get<ChainPositions::LoPass>();
+  if (w < 2)
+    return;
 
   auto sampleRate = audioProcessor.getSampleRate();
 
-  std::vector<double> mags;
-
-  mags.resize(w);
-
-  for ( int i = 0; i < w; ++i)
+  if (sampleRate != phiSampleRate)
   {
-    double mag = 1.f;
-    auto freq = mapToLog10(double(i)/double(w), 20.0, 20000.0);
-
-    if(! hpFilter.isBypassed<0>())
-      mag *= hpFilter.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! hpFilter.isBypassed<1>())
-      mag *= hpFilter.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! hpFilter.isBypassed<2>())
-      mag *= hpFilter.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! hpFilter.isBypassed<3>())
-      mag *= hpFilter.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-    if(! monoChain.isBypassed<ChainPositions::LoPeak>())
-      mag *= peak1.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! monoChain.isBypassed<ChainPositions::MidPeak>())
-      mag *= peak2.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! monoChain.isBypassed<ChainPositions::HiPeak>())
-      mag *= peak3.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-    if(! lpFilter.isBypassed<0>())
-      mag *= lpFilter.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! lpFilter.isBypassed<1>())
-      mag *= lpFilter.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! lpFilter.isBypassed<2>())
-      mag *= lpFilter.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-    if(! lpFilter.isBypassed<3>())
-      mag *= lpFilter.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-    mags[i] = Decibels::gainToDecibels(mag);
+    for ( int i = 0; i < w; ++i)
+    {
+      auto freq = mapToLog10(double(i)/double(w), 20.0, 20000.0);
+      auto halfOmega = MathConstants<double>::pi * freq / sampleRate;
+      phi[i] = float(std::sin(halfOmega) * std::sin(halfOmega));
+    }
+
+    phiSampleRate = sampleRate;
   }
 
-  Path responseCurve;
+  std::array<BiquadCoefficients, FilterCascade::numSlots> sections;
+  const auto numSections = getActiveSections(filterBank, sections);
+
+  DSPKernels::get().magnitudeResponse(sections.data(), numSections, phi.data(), mags.data(), mags.size());
+
   const double outputMin = responseArea.getBottom();
   const double outputMax = responseArea.getY();
-  auto map = [outputMin, outputMax](double input)
+  auto map = [outputMin, outputMax](float mag)
   {
-    return jmap(input, -24.0, 24.0, outputMin, outputMax);
+    return (float) jmap((double) Decibels::gainToDecibels(mag), -24.0, 24.0, outputMin, outputMax);
   };
 
-  responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
+  // clear() keeps the path's storage, so rebuilding it does not allocate.
+  responseCurve.clear();
+  responseCurve.startNewSubPath((float) responseArea.getX(), map(mags.front()));
 
-  for (size_t i = 1; i < mags.size(); ++i)
+  for (int i = 1; i < w; ++i)
   {
-    responseCurve.lineTo(responseArea.getX()+i, map(mags[i]));
+    responseCurve.lineTo((float) (responseArea.getX()+i), map(mags[(size_t) i]));
   }
 
+  const auto oldBounds = curveBounds;
+  curveBounds = responseCurve.getBounds().expanded(2.f).getSmallestIntegerContainer()
+                  .getIntersection(responseArea);
+
+  repaint(oldBounds.getUnion(curveBounds));
+}
+
+void ResponseCurveComponent::renderBackground()
+{
+  using namespace juce;
+
+  const auto scale = Component::getApproximateScaleFactorForComponent(this);
+  const auto bounds = getLocalBounds();
+
+  background = Image(Image::RGB, jmax(1, roundToInt(bounds.getWidth()*scale)),
+                     jmax(1, roundToInt(bounds.getHeight()*scale)), true);
+
+  Graphics g(background);
+  g.addTransform(AffineTransform::scale(scale));
+
+  g.fillAll (Colours::black);
   g.setColour(Colours::orange);
-  g.drawRoundedRectangle(responseArea.toFloat(), 4.f,1.f);
+  g.drawRoundedRectangle(bounds.toFloat(), 4.f,1.f);
+}
+
+void ResponseCurveComponent::resized()
+{
+  const auto w = (size_t) juce::jmax(0, getWidth());
+
+  phi.resize(w);
+  mags.resize(w);
+  phiSampleRate = 0.0;
+
+  responseCurve.clear();
+  responseCurve.preallocateSpace(3 * (int) w + 3);
+
+  renderBackground();
+  updateResponseCurve();
+  repaint();
+}
+
+void ResponseCurveComponent::paint (juce::Graphics& g)
+{
+  EQ5B_TRACE_SCOPE("ResponseCurveComponent::paint");
+
+  using namespace juce;
+  // (Our component is opaque, so we must completely fill the background with a solid colour)
+  g.drawImage(background, getLocalBounds().toFloat());
 
   g.setColour(Colours::white);
   g.strokePath(responseCurve, PathStrokeType(2.f));
 
 }
 
+//==============================================================================
+LevelMeterComponent::LevelMeterComponent(SignalMeters& m) : meters(m)
+{
+  setOpaque(true);
+  startTimerHz(frameRate);
+}
+
+void LevelMeterComponent::update(Display& display, const SignalMeters::Reading& reading)
+{
+  using namespace juce;
+
+  const auto decay = peakDecayDbPerSecond / (float) frameRate;
+
+  for (int channel = 0; channel < 2; ++channel)
+  {
+    const auto peakDb = Decibels::gainToDecibels(reading.peak[channel], minDb);
+    display.peakDb[channel] = jmax(peakDb, display.peakDb[channel] - decay, minDb);
+    display.rmsDb[channel] = Decibels::gainToDecibels(reading.rms[channel], minDb);
+  }
+
+  display.correlation = reading.correlation;
+  display.numChannels = reading.numChannels;
+}
+
+void LevelMeterComponent::timerCallback()
+{
+  const auto previousInput = input;
+  const auto previousOutput = output;
+
+  update(input, meters.read(SignalMeters::Stage::input, readPosition));
+  update(output, meters.read(SignalMeters::Stage::output, readPosition));
+
+  // Idle meters stay at the floor; only repaint when something moved.
+  if (std::memcmp(&previousInput, &input, sizeof(Display)) != 0
+      || std::memcmp(&previousOutput, &output, sizeof(Display)) != 0)
+    repaint();
+}
+
+void LevelMeterComponent::paintBars(juce::Graphics& g, juce::Rectangle<float> area, const Display& display,
+                                    const juce::String& label)
+{
+  using namespace juce;
+
+  g.setColour(Colours::orange);
+  g.setFont(10.f);
+  g.drawText(label, area.removeFromBottom(12.f), Justification::centred);
+
+  const auto numBars = jmax(1, display.numChannels);
+  const auto barWidth = area.getWidth() / (float) numBars;
+
+  for (int channel = 0; channel < numBars; ++channel)
+  {
+    const auto bar = area.withX(area.getX() + barWidth * (float) channel).withWidth(barWidth).reduced(1.f, 0.f);
+    auto yFor = [&bar](float db) { return jmap(db, minDb, 0.f, bar.getBottom(), bar.getY()); };
+
+    g.setColour(Colours::darkgrey);
+    g.fillRect(bar);
+
+    g.setColour(Colours::green);
+    g.fillRect(bar.withTop(yFor(display.rmsDb[channel])));
+
+    g.setColour(display.peakDb[channel] >= 0.f ? Colours::red : Colours::white);
+    g.fillRect(bar.withTop(yFor(display.peakDb[channel])).withHeight(1.5f));
+  }
+}
+
+void LevelMeterComponent::paint(juce::Graphics& g)
+{
+  using namespace juce;
+
+  g.fillAll(Colours::black);
+
+  auto bounds = getLocalBounds().toFloat().reduced(3.f);
+
+  // Correlation runs from -1 on the left to +1 on the right.
+  auto correlationArea = bounds.removeFromBottom(8.f);
+  g.setColour(Colours::darkgrey);
+  g.fillRect(correlationArea);
+
+  const auto centre = correlationArea.getCentreX();
+  const auto position = jmap(output.correlation, -1.f, 1.f, correlationArea.getX(), correlationArea.getRight());
+  g.setColour(output.correlation < 0.f ? Colours::red : Colours::green);
+  g.fillRect(Rectangle<float>::leftTopRightBottom(jmin(centre, position), correlationArea.getY(),
+                                                  jmax(centre, position), correlationArea.getBottom()));
+
+  bounds.removeFromBottom(3.f);
+  const auto half = bounds.getWidth() * 0.5f;
+  paintBars(g, bounds.removeFromLeft(half).reduced(1.f, 0.f), input, "IN");
+  paintBars(g, bounds.reduced(1.f, 0.f), output, "OUT");
+}
+
+//==============================================================================
+SnapshotMorphComponent::SnapshotMorphComponent(EQ5bAudioProcessor& p) : audioProcessor(p),
+  morphAttachment(p.processorParameters, "morph", morphSlider),
+  engageAttachment(p.processorParameters, "morphEngaged", engageButton)
+{
+  static_assert(std::tuple_size<decltype(snapshotButtons)>::value == SnapshotMorph::maxSnapshots);
+
+  morphSlider.setSliderStyle(juce::Slider::SliderStyle::LinearHorizontal);
+  addAndMakeVisible(morphSlider);
+  addAndMakeVisible(engageButton);
+
+  for (int index = 0; index < SnapshotMorph::maxSnapshots; ++index)
+  {
+    auto& button = snapshotButtons[(size_t) index];
+    button.setButtonText(juce::String::charToString(juce::juce_wchar('A' + index)));
+    button.onClick = [this, index]
+    {
+      audioProcessor.storeSnapshot(index);
+      updateButtons();
+    };
+    button.onPopupMenu = [this, index]
+    {
+      audioProcessor.getSnapshotMorph().clear(index);
+      updateButtons();
+    };
+    addAndMakeVisible(button);
+  }
+
+  updateButtons();
+  startTimerHz(4);
+}
+
+void SnapshotMorphComponent::updateButtons()
+{
+  for (int index = 0; index < SnapshotMorph::maxSnapshots; ++index)
+    snapshotButtons[(size_t) index].setToggleState(audioProcessor.getSnapshotMorph().isStored(index),
+                                                   juce::dontSendNotification);
+}
+
+void SnapshotMorphComponent::timerCallback()
+{
+  updateButtons();
+}
+
+void SnapshotMorphComponent::resized()
+{
+  auto bounds = getLocalBounds().reduced(2);
+
+  engageButton.setBounds(bounds.removeFromLeft(80));
+
+  for (auto& button : snapshotButtons)
+    button.setBounds(bounds.removeFromLeft(32).reduced(2, 0));
+
+  morphSlider.setBounds(bounds);
+}
+
 //==============================================================================
 EQ5bAudioProcessorEditor::EQ5bAudioProcessorEditor (EQ5bAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
     responseCurveComponent(audioProcessor),
+    levelMeterComponent(audioProcessor.signalMeters),
+    snapshotMorphComponent(audioProcessor),
     hpFreqSliderAttachment(audioProcessor.processorParameters,"hpFreq", hpFreqSlider),
     hpSlopeSliderAttachment(audioProcessor.processorParameters,"hpSlope", hpSlopeSlider),
     lpFreqSliderAttachment(audioProcessor.processorParameters,"lpFreq",lpFreqSlider),
@@ -155,9 +347,42 @@ EQ5bAudioProcessorEditor::EQ5bAudioProcessorEditor (EQ5bAudioProcessor& p)
     {
       addAndMakeVisible(comp); 
     } 
+
+    // In the order of MidiControl::getLearnableParameterIDs().
+    rotaryKnob* learnableKnobs[] { &hpFreqSlider, &hpSlopeSlider, &lpFreqSlider, &lpSlopeSlider,
+                                   &p1GainSlider, &p1FreqSlider, &p1QSlider,
+                                   &p2GainSlider, &p2FreqSlider, &p2QSlider,
+                                   &p3GainSlider, &p3FreqSlider, &p3QSlider,
+                                   &snapshotMorphComponent.morphSlider };
+    static_assert(std::size(learnableKnobs) == MidiControl::numLearnable);
+
+    for (int i = 0; i < MidiControl::numLearnable; ++i)
+        learnableKnobs[i]->onPopupMenu = [this, i] { showMidiLearnMenu(i); };
+
     setSize (1200, 400);
 }
 
+void EQ5bAudioProcessorEditor::showMidiLearnMenu(int parameterIndex)
+{
+    auto& midiControl = audioProcessor.midiControl;
+    const auto learning = midiControl.isLearning(parameterIndex);
+    const auto controller = midiControl.getController(parameterIndex);
+
+    juce::PopupMenu menu;
+    menu.addItem("MIDI Learn", true, learning, [&midiControl, parameterIndex, learning]
+    {
+        if (learning)
+            midiControl.cancelLearning();
+        else
+            midiControl.learn(parameterIndex);
+    });
+
+    if (controller >= 0)
+        menu.addItem("Forget CC " + juce::String(controller), [&midiControl, parameterIndex] { midiControl.forget(parameterIndex); });
+
+    menu.showMenuAsync(juce::PopupMenu::Options());
+}
+
 EQ5bAudioProcessorEditor::~EQ5bAudioProcessorEditor()
 {
 }
@@ -174,7 +399,9 @@ void EQ5bAudioProcessorEditor::resized()
     auto bounds = getLocalBounds();
     auto responseArea = bounds.removeFromTop(bounds.getHeight()*0.33);
 
+    levelMeterComponent.setBounds(responseArea.removeFromRight(80));
     responseCurveComponent.setBounds(responseArea);
+    snapshotMorphComponent.setBounds(bounds.removeFromBottom(32));
 
     auto hpArea = bounds.removeFromLeft(bounds.getWidth()*0.2);
     auto lpArea = bounds.removeFromRight(bounds.getWidth()*0.25);
@@ -217,6 +444,8 @@ std::vector<juce::Component*> EQ5bAudioProcessorEditor::getComps()
     &p3QSlider,
     &lpFreqSlider,
     &lpSlopeSlider, 
-    &responseCurveComponent
+    &responseCurveComponent,
+    &levelMeterComponent,
+    &snapshotMorphComponent
   };
 }
@@ -18,23 +18,125 @@ struct rotaryKnob : juce::Slider
   {
 
   }
+
+  /** Called instead of dragging when the knob is right-clicked. */
+  std::function<void()> onPopupMenu;
+
+  void mouseDown (const juce::MouseEvent& e) override
+  {
+    if (e.mods.isPopupMenu() && onPopupMenu)
+      onPopupMenu();
+    else
+      juce::Slider::mouseDown (e);
+  }
 };
 
+/** The timer only runs while parameters are changing: a parameter change
+    wakes it and it stops after idleTicksBeforeSleeping quiet frames. The curve
+    is rebuilt in the timer into buffers sized in resized(), paint draws it over
+    a cached background, and only the area the curve moved through is repainted.
+*/
 struct ResponseCurveComponent : juce::Component,
 juce::AudioProcessorParameter::Listener,
-juce::Timer
+juce::Timer,
+juce::AsyncUpdater
 {
   ResponseCurveComponent(EQ5bAudioProcessor&);
   ~ResponseCurveComponent();
   void parameterValueChanged (int parameterIndex, float newValue) override;
   void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override { }  
   void timerCallback() override;
+  void handleAsyncUpdate() override;
   void paint(juce::Graphics& g) override;
+  void resized() override;
 
 private:
+    static constexpr int idleTicksBeforeSleeping = 30;
+
+    void updateResponseCurve();
+    void renderBackground();
+
     EQ5bAudioProcessor& audioProcessor;
     juce::Atomic<bool> parametersChanged {false};
-    MonoChain monoChain;
+    FilterBank filterBank;
+    int idleTicks = 0;
+
+    juce::Image background;
+    std::vector<float> phi, mags;
+    double phiSampleRate = 0.0;
+    juce::Path responseCurve;
+    juce::Rectangle<int> curveBounds;
+};
+
+/** Input and output peak and RMS bars for the first two channels and the
+    output's stereo correlation. Polls SignalMeters at frameRate; the peaks
+    fall back at peakDecayDbPerSecond here rather than on the audio thread.
+*/
+struct LevelMeterComponent : juce::Component,
+juce::Timer
+{
+  LevelMeterComponent(SignalMeters&);
+  void timerCallback() override;
+  void paint(juce::Graphics& g) override;
+
+private:
+    static constexpr int frameRate = 30;
+    static constexpr float minDb = -60.f;
+    static constexpr float peakDecayDbPerSecond = 20.f;
+
+    struct Display
+    {
+      float peakDb[2] { minDb, minDb };
+      float rmsDb[2] { minDb, minDb };
+      float correlation = 0.f;
+      int numChannels = 0;
+    };
+
+    static void update(Display& display, const SignalMeters::Reading& reading);
+    void paintBars(juce::Graphics& g, juce::Rectangle<float> area, const Display& display, const juce::String& label);
+
+    SignalMeters& meters;
+    SignalMeters::ReadPosition readPosition;
+    Display input, output;
+};
+
+struct snapshotButton : juce::TextButton
+{
+  /** Called instead of clicking when the button is right-clicked. */
+  std::function<void()> onPopupMenu;
+
+  void mouseDown (const juce::MouseEvent& e) override
+  {
+    if (e.mods.isPopupMenu() && onPopupMenu)
+      onPopupMenu();
+    else
+      juce::TextButton::mouseDown (e);
+  }
+};
+
+/** The morph slider, its engage switch and a button per snapshot: a click
+    stores the current settings, a right-click clears the snapshot. Stored
+    snapshots are lit; the timer follows stores that come with a restored
+    state.
+*/
+struct SnapshotMorphComponent : juce::Component,
+juce::Timer
+{
+  SnapshotMorphComponent(EQ5bAudioProcessor&);
+  void timerCallback() override;
+  void resized() override;
+
+  rotaryKnob morphSlider;
+
+private:
+    void updateButtons();
+
+    EQ5bAudioProcessor& audioProcessor;
+    juce::ToggleButton engageButton { "Morph" };
+    std::array<snapshotButton, 4> snapshotButtons;
+
+    juce::AudioProcessorValueTreeState::SliderAttachment morphAttachment;
+    juce::AudioProcessorValueTreeState::ButtonAttachment engageAttachment;
 };
 
 //==============================================================================
@@ -71,6 +173,8 @@ private:
     lpSlopeSlider;
 
     ResponseCurveComponent responseCurveComponent;
+    LevelMeterComponent levelMeterComponent;
+    SnapshotMorphComponent snapshotMorphComponent;
 
     using Attachment = juce::AudioProcessorValueTreeState::SliderAttachment;
 
@@ -90,5 +194,8 @@ private:
 
     std::vector<juce::Component*> getComps();
 
+    /** MIDI Learn / Forget menu for one of MidiControl's learnable parameters. */
+    void showMidiLearnMenu (int parameterIndex);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EQ5bAudioProcessorEditor)
 };
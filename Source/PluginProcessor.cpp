@@ -8,8 +8,17 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "FilterCascade.h"
+#include "ResponseSnapshot.h"
+#include "SnapshotMorph.h"
+#include "ButterworthDesign.h"
+#include "MatchedDesign.h"
 #include <JucePluginDefines.h>
 
+// MidiControl only sees CCs if the plugin has a MIDI input, which
+// JucePluginDefines.h takes from the .jucer's plugin characteristics.
+static_assert(JucePlugin_WantsMidiInput, "JuceLibraryCode is out of date: re-save EQ5b.jucer in the Projucer");
+
 //==============================================================================
 EQ5bAudioProcessor::EQ5bAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -23,31 +32,62 @@ EQ5bAudioProcessor::EQ5bAudioProcessor()
                        )
 #endif
 {
+    cascade = std::make_unique<FilterCascade>();
+    snapshotMorph = std::make_unique<SnapshotMorph>();
+    midiControl.attach(processorParameters);
+    processorParameters.addParameterListener("channelThreads", this);
+    processorParameters.addParameterListener("stereoMode", this);
+    processorParameters.addParameterListener("filterForm", this);
 }
 
 EQ5bAudioProcessor::~EQ5bAudioProcessor()
 {
+    processorParameters.removeParameterListener("channelThreads", this);
+    processorParameters.removeParameterListener("stereoMode", this);
+    processorParameters.removeParameterListener("filterForm", this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
 void EQ5bAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
-    spec.sampleRate = sampleRate;
+    EQ5B_TRACE_SCOPE("prepareToPlay");
+
+    const auto numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    cascade->prepare(numChannels, sampleRate);
+
+    if (getFilterForm(processorParameters) == FilterCascade::Form::parallel)
+        cascade->startParallelDesigner();
+
+    updateCascade(*cascade, filterBank, false);
+
+    {
+        // Only a stereo bus can run dual mono, and only one that has been set
+        // to it pays for the second cascade.
+        const juce::ScopedLock lock(rightCascadeLock);
 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+        if (auto* right = rightCascade.load())
+        {
+            right->prepare(1, sampleRate);
+            updateCascade(*right, rightFilterBank, true);
+        }
+        else if (numChannels == 2 && isDualMonoSelected())
+        {
+            createRightCascade(sampleRate);
+        }
+    }
 
-    auto chainSettings = getChainSettings(processorParameters);
+    snapshotMorph->prepare(numChannels, sampleRate);
+    if (processorParameters.getRawParameterValue("channelThreads")->load() > 0.5f)
+        createChannelWorkers();
 
-    updateCutFilters(ChainPositions::HiPass, chainSettings.hpFilter);
-    updatePeakFilters(ChainPositions::LoPeak, chainSettings.loPeak);
-    updatePeakFilters(ChainPositions::MidPeak, chainSettings.midPeak);
-    updatePeakFilters(ChainPositions::HiPeak, chainSettings.hiPeak);
-    updateCutFilters(ChainPositions::LoPass, chainSettings.lpFilter);
+    signalMeters.prepare(sampleRate, numChannels);
+    processedDualMono = false;
+    processedMorphing = false;
 
+    handOverBuffer.setSize(numChannels, juce::jmax(samplesPerBlock, 1));
+    handOverFade = juce::jmax(1, juce::roundToInt(handOverFadeSeconds * sampleRate));
+    handOverPosition = -1;
 }
     
 const juce::String EQ5bAudioProcessor::getName() const
@@ -126,12 +166,12 @@ bool EQ5bAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel runs the same filters, so any bus from mono up to wide
+    // immersive and array layouts works; channelThreads spreads the wide ones
+    // over worker threads.
+    const auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numChannels < 1 || numChannels > 64)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -147,6 +187,8 @@ bool EQ5bAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
 
 void EQ5bAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    EQ5B_TRACE_SCOPE("processBlock");
+
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -162,22 +204,336 @@ void EQ5bAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::M
 
     juce::dsp::AudioBlock<float> block(buffer);
 
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    const auto useChannelThreads = processorParameters.getRawParameterValue("channelThreads")->load() > 0.5f;
+    const auto autoGain = processorParameters.getRawParameterValue("autoGain")->load() > 0.5f;
+    cascade->setChannelWorkers(useChannelThreads ? channelWorkers.load(std::memory_order_acquire) : nullptr);
+    cascade->setAutoGain(autoGain);
+
+    auto* right = rightCascade.load(std::memory_order_acquire);
+
+    if (right != nullptr)
+        right->setAutoGain(autoGain);
+
+    const auto dualMono = right != nullptr && block.getNumChannels() == 2 && isDualMonoSelected();
+    const auto morphEngaged = processorParameters.getRawParameterValue("morphEngaged")->load() > 0.5f;
+    const auto morphAvailable = snapshotMorph->update();
+    const auto morphing = morphAvailable && morphEngaged;
+
+    if (dualMono != processedDualMono)
+    {
+        // The right channel moves between the cascades and takes its state
+        // along, so the switch is heard as a change of coefficients. The left
+        // channel stays where it is, and the morph carries its second channel
+        // over itself.
+        if (dualMono)
+        {
+            updateCascade(*right, rightFilterBank, true);
+            right->copyChannelState(*cascade, 1, 0);
+        }
+        else if (right != nullptr)
+        {
+            cascade->copyChannelState(*right, 0, 1);
+        }
+
+        processedDualMono = dualMono;
+    }
+
+    if (morphing != processedMorphing)
+    {
+        if (handOverPosition >= 0)
+        {
+            // Both paths are still running, so the one being handed over from
+            // takes over again: at once while it is all that is heard, or by
+            // fading back from wherever the fade has got to.
+            const auto faded = handOverPosition - handOverWarmUp;
+            handOverPosition = faded > 0 ? handOverWarmUp + handOverFade - faded : -1;
+        }
+        else
+        {
+            auto lowestCutHz = filterBank.lowestCutHz;
+
+            if (morphing)
+            {
+                snapshotMorph->reset();
+                lowestCutHz = snapshotMorph->getLowestCutHz();
+                lastMorph = processorParameters.getRawParameterValue("morph")->load();
+            }
+            else
+            {
+                cascade->reset();
+
+                if (right != nullptr)
+                    right->reset();
+
+                if (dualMono)
+                    lowestCutHz = juce::jmin(lowestCutHz, rightFilterBank.lowestCutHz);
+            }
+
+            const auto settleSeconds = lowestCutHz > 0.f ? handOverCycles / lowestCutHz : 0.0;
+            handOverWarmUp = juce::roundToInt(juce::jmax(handOverSeconds, settleSeconds) * getSampleRate());
+            handOverPosition = 0;
+        }
+
+        processedMorphing = morphing;
+    }
+
+    // The morph cannot run without two snapshots, so a hand-over to or from
+    // it ends when one is cleared.
+    if (! morphAvailable)
+        handOverPosition = -1;
+
+    // The linked cascade meters each chunk as it runs it; the other paths
+    // leave the meters a pass of their own before and after.
+    const auto cascadeMeters = ! dualMono && ! morphing && handOverPosition < 0;
+    cascade->setSignalMeters(cascadeMeters ? &signalMeters : nullptr);
+
+    if (! cascadeMeters)
+        signalMeters.add(SignalMeters::Stage::input, block);
+
+    auto redesign = [this, right, dualMono]
+    {
+        EQ5B_TRACE_SCOPE("redesign");
+
+        updateCascade(*cascade, filterBank, false);
+
+        if (dualMono)
+            updateCascade(*right, rightFilterBank, true);
+    };
+
+    // The block is split where mapped CCs arrive, so their parameter changes
+    // are heard from their own sample on. The cascades only read parameters
+    // when they are redesigned, so each split's CCs are applied after the
+    // segment before it has been processed.
+    const auto numSamples = (int) block.getNumSamples();
+    auto segmentStart = 0, lastSplit = -1;
+
+    for (const auto metadata : midiMessages)
+    {
+        const auto message = metadata.getMessage();
+
+        if (! midiControl.isMapped(message))
+            continue;
+
+        const auto position = juce::jlimit(0, numSamples, metadata.samplePosition);
+
+        if (lastSplit < 0 || position >= lastSplit + minSplitSamples)
+        {
+            if (lastSplit >= 0)
+                redesign();
+
+            processSegment(block.getSubBlock((size_t) segmentStart, (size_t) (position - segmentStart)), dualMono, morphing);
+            segmentStart = lastSplit = position;
+        }
+
+        midiControl.handle(message);
+    }
+
+    if (lastSplit >= 0)
+        redesign();
+
+    processSegment(block.getSubBlock((size_t) segmentStart, (size_t) (numSamples - segmentStart)), dualMono, morphing);
+
+    if (! cascadeMeters)
+        signalMeters.add(SignalMeters::Stage::output, block);
+
+    signalMeters.publish();
+
+    redesign();
+}
+
+void EQ5bAudioProcessor::processSegment(juce::dsp::AudioBlock<float> segment, bool dualMono, bool morphing)
+{
+    const auto numSamples = segment.getNumSamples();
+
+    // A CC that moved the morph is heard as a ramp across the segment after
+    // its split; automation ramps across the block.
+    const auto morphStart = lastMorph;
+    const auto morphEnd = processorParameters.getRawParameterValue("morph")->load();
+    size_t start = 0;
+
+    // During a hand-over the outgoing path runs on a copy of the input, in
+    // pieces that fit the copy, and the output crossfades from it.
+    while (handOverPosition >= 0 && start < numSamples)
+    {
+        const auto length = juce::jmin((size_t) handOverBuffer.getNumSamples(), numSamples - start);
+        const auto chunk = segment.getSubBlock(start, length);
+        auto outgoing = juce::dsp::AudioBlock<float>(handOverBuffer)
+                            .getSubsetChannelBlock(0, chunk.getNumChannels())
+                            .getSubBlock(0, length);
+        const auto chunkMorphEnd = morphStart + (morphEnd - morphStart) * (float) (start + length) / (float) numSamples;
+
+        outgoing.copyFrom(chunk);
+        processPath(outgoing, dualMono, ! morphing, chunkMorphEnd);
+        processPath(chunk, dualMono, morphing, chunkMorphEnd);
+
+        const auto position = handOverPosition - handOverWarmUp;
+
+        for (size_t ch = 0; ch < chunk.getNumChannels(); ++ch)
+        {
+            auto* samples = chunk.getChannelPointer(ch);
+            const auto* faded = outgoing.getChannelPointer(ch);
+
+            for (size_t i = 0; i < length; ++i)
+            {
+                const auto mix = juce::jlimit(0.f, 1.f, (float) (position + (int) i) / (float) handOverFade);
+                samples[i] = faded[i] + mix * (samples[i] - faded[i]);
+            }
+        }
+
+        handOverPosition += (int) length;
+
+        if (handOverPosition >= handOverWarmUp + handOverFade)
+            handOverPosition = -1;
+
+        start += length;
+    }
+
+    if (start < numSamples)
+        processPath(segment.getSubBlock(start, numSamples - start), dualMono, morphing, morphEnd);
+}
+
+void EQ5bAudioProcessor::processPath(juce::dsp::AudioBlock<float> block, bool dualMono, bool morphing, float morphEnd)
+{
+    if (morphing)
+    {
+        EQ5B_TRACE_SCOPE("SnapshotMorph::process");
+
+        snapshotMorph->process(block, dualMono, lastMorph, morphEnd);
+        lastMorph = morphEnd;
+        return;
+    }
+
+    EQ5B_TRACE_SCOPE("FilterCascade::process");
+
+    if (dualMono)
+    {
+        // Each side runs its own section matrices; per channel the work is
+        // the same as in linked stereo.
+        auto leftBlock = block.getSingleChannelBlock(0);
+        auto rightBlock = block.getSingleChannelBlock(1);
+        cascade->process(juce::dsp::ProcessContextReplacing<float>(leftBlock));
+        rightCascade.load(std::memory_order_acquire)->process(juce::dsp::ProcessContextReplacing<float>(rightBlock));
+    }
+    else
+    {
+        cascade->process(juce::dsp::ProcessContextReplacing<float>(block));
+    }
+}
+
+void EQ5bAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    const auto exists = parameterID == "stereoMode"   ? rightCascade.load() != nullptr
+                      : parameterID == "filterForm" ? cascade->hasParallelDesigner()
+                                                    : channelWorkers.load() != nullptr;
+
+    if (newValue < 0.5f || exists)
+        return;
+
+    // Automation can switch any of these on from the audio thread, which must
+    // not start threads or allocate.
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        handleAsyncUpdate();
+    else
+        triggerAsyncUpdate();
+}
+
+void EQ5bAudioProcessor::handleAsyncUpdate()
+{
+    if (processorParameters.getRawParameterValue("channelThreads")->load() > 0.5f)
+        createChannelWorkers();
+
+    if (getFilterForm(processorParameters) == FilterCascade::Form::parallel)
+        startParallelDesigners();
+
+    // Before the first prepareToPlay there is no rate to prepare for, and
+    // prepareToPlay creates it then.
+    if (isDualMonoSelected() && getSampleRate() > 0
+        && juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()) == 2)
+        createRightCascade(getSampleRate());
+}
+
+void EQ5bAudioProcessor::createChannelWorkers()
+{
+    const juce::ScopedLock lock(channelWorkersLock);
+
+    if (channelWorkerPool != nullptr)
+        return;
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    channelWorkerPool = std::make_unique<juce::SharedResourcePointer<ChannelWorkerPool>>();
+    channelWorkers.store(&channelWorkerPool->getObject(), std::memory_order_release);
+}
+
+void EQ5bAudioProcessor::createRightCascade(double sampleRate)
+{
+    const juce::ScopedLock lock(rightCascadeLock);
+
+    if (rightCascadeObject != nullptr)
+        return;
+
+    // Published only once prepared; the audio thread picks up the sections
+    // when it switches to dual mono.
+    rightCascadeObject = std::make_unique<FilterCascade>();
+    rightCascadeObject->prepare(1, sampleRate);
+
+    if (getFilterForm(processorParameters) == FilterCascade::Form::parallel)
+        rightCascadeObject->startParallelDesigner();
+
+    rightCascade.store(rightCascadeObject.get(), std::memory_order_release);
+}
+
+void EQ5bAudioProcessor::startParallelDesigners()
+{
+    cascade->startParallelDesigner();
+
+    const juce::ScopedLock lock(rightCascadeLock);
+
+    if (rightCascadeObject != nullptr)
+        rightCascadeObject->startParallelDesigner();
+}
+
+bool EQ5bAudioProcessor::isDualMonoSelected()
+{
+    return static_cast<StereoMode>(processorParameters.getRawParameterValue("stereoMode")->load()) == stereo_dualMono;
+}
+
+
+bool EQ5bAudioProcessor::isUsingOfflineTier()
+{
+    switch (static_cast<QualityTier>(processorParameters.getRawParameterValue("quality")->load()))
+    {
+        case quality_realtime: return false;
+        case quality_offline:  return true;
+        case quality_auto:     break;
+    }
+
+    return isNonRealtime();
+}
+
+ChainSettings EQ5bAudioProcessor::getEngineSettings(bool rightChannel)
+{
+    auto settings = getChainSettings(processorParameters, rightChannel);
+
+    // Matched sections follow the analog curves up to Nyquist, where the
+    // bilinear ones cramp, without the latency oversampling would add.
+    if (isUsingOfflineTier())
+    {
+        settings.hpFilter.design = settings.lpFilter.design = design_matched;
+        for (auto& peak : settings.peaks)
+            peak.design = design_matched;
+    }
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    return settings;
+}
 
-    auto chainSettings = getChainSettings(processorParameters);
+void EQ5bAudioProcessor::updateCascade(FilterCascade& target, FilterBank& bank, bool rightChannel)
+{
+    updateFilterBank(bank, getEngineSettings(rightChannel), getSampleRate());
 
-    updateCutFilters(ChainPositions::HiPass, chainSettings.hpFilter);
-    updatePeakFilters(ChainPositions::LoPeak, chainSettings.loPeak);
-    updatePeakFilters(ChainPositions::MidPeak, chainSettings.midPeak);
-    updatePeakFilters(ChainPositions::HiPeak, chainSettings.hiPeak);
-    updateCutFilters(ChainPositions::LoPass, chainSettings.lpFilter);
+    // The parallel form is within 1e-3 of the cascade; offline renders take
+    // the exact one. The cascade hands state over between tiers the way it
+    // does for any coefficient change, and a form switch starts from silence.
+    target.setForm(isUsingOfflineTier() ? FilterCascade::Form::cascade : getFilterForm(processorParameters));
+    target.setSections(bank);
 }
 //==============================================================================
 bool EQ5bAudioProcessor::hasEditor() const
@@ -197,113 +553,242 @@ void EQ5bAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     juce::MemoryOutputStream mos(destData, true);
-    processorParameters.state.writeToStream(mos);
+
+    // The CC mapping travels in the state as a child of the parameters.
+    auto state = processorParameters.copyState();
+    state.removeChild(state.getChildWithName(MidiControl::stateType), nullptr);
+    state.appendChild(midiControl.toValueTree(), nullptr);
+    state.removeChild(state.getChildWithName(SnapshotMorph::stateType), nullptr);
+    state.appendChild(snapshotMorph->toValueTree(), nullptr);
+    state.writeToStream(mos);
 }
 
 void EQ5bAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    EQ5B_TRACE_SCOPE("setStateInformation");
+
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if ( tree.isValid() )
     {
+        // Only the parameters change here. The banks belong to the audio
+        // thread, which redesigns them from the parameters after every block
+        // and in prepareToPlay; writing them from this thread raced with it.
         processorParameters.replaceState(tree);
-        
-        auto chainSettings = getChainSettings(processorParameters);
-
-        updateCutFilters(ChainPositions::HiPass, chainSettings.hpFilter);
-        updatePeakFilters(ChainPositions::LoPeak, chainSettings.loPeak);
-        updatePeakFilters(ChainPositions::MidPeak, chainSettings.midPeak);
-        updatePeakFilters(ChainPositions::HiPeak, chainSettings.hiPeak);
-        updateCutFilters(ChainPositions::LoPass, chainSettings.lpFilter);
+        midiControl.fromValueTree(tree.getChildWithName(MidiControl::stateType));
+        snapshotMorph->fromValueTree(tree.getChildWithName(SnapshotMorph::stateType));
     }
 }
 
+ResponseSnapshot EQ5bAudioProcessor::getResponseSnapshot(bool rightChannel)
+{
+    // The raw parameter values are atomics, so this designs its own bank
+    // rather than touching the one the audio thread owns.
+    return ResponseSnapshot(getEngineSettings(rightChannel), getSampleRate());
+}
+
+void EQ5bAudioProcessor::storeSnapshot(int index)
+{
+    // The snapshot keeps the design chosen by "filterDesign"; the offline
+    // tier does not apply to the morph.
+    snapshotMorph->store(index, getChainSettings(processorParameters, false),
+                         getChainSettings(processorParameters, true));
+}
+
 //==============================================================================
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &processorParameters)
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &processorParameters, bool rightChannel)
 {
-    ChainSettings settings;
-    settings.hpFilter.cutf = processorParameters.getRawParameterValue("hpFreq")->load();
-    settings.hpFilter.slope = static_cast<Slope>(processorParameters.getRawParameterValue("hpSlope")->load());
+    const auto& channelIDs = getChannelParameterIDs(rightChannel);
 
-    settings.lpFilter.cutf = processorParameters.getRawParameterValue("lpFreq")->load();
-    settings.lpFilter.slope = static_cast<Slope>(processorParameters.getRawParameterValue("lpSlope")->load());
+    ChainSettings settings;
+    settings.hpFilter.cutf = processorParameters.getRawParameterValue(channelIDs.hpFreq)->load();
+    settings.hpFilter.slope = static_cast<Slope>(processorParameters.getRawParameterValue(channelIDs.hpSlope)->load());
 
-    settings.loPeak.freq = processorParameters.getRawParameterValue("peakFreq1")->load();
-    settings.loPeak.gain = processorParameters.getRawParameterValue("peakGain1")->load();
-    settings.loPeak.q = processorParameters.getRawParameterValue("peakQ1")->load();
+    settings.lpFilter.cutf = processorParameters.getRawParameterValue(channelIDs.lpFreq)->load();
+    settings.lpFilter.slope = static_cast<Slope>(processorParameters.getRawParameterValue(channelIDs.lpSlope)->load());
 
-    settings.midPeak.freq = processorParameters.getRawParameterValue("peakFreq2")->load();
-    settings.midPeak.gain = processorParameters.getRawParameterValue("peakGain2")->load();
-    settings.midPeak.q = processorParameters.getRawParameterValue("peakQ2")->load();
+    settings.numBands = static_cast<int>(processorParameters.getRawParameterValue(channelIDs.numBands)->load());
 
-    settings.hiPeak.freq = processorParameters.getRawParameterValue("peakFreq3")->load();
-    settings.hiPeak.gain = processorParameters.getRawParameterValue("peakGain3")->load();
-    settings.hiPeak.q = processorParameters.getRawParameterValue("peakQ3")->load();
+    for (int band = 0; band < settings.numBands; ++band)
+    {
+        const auto& ids = channelIDs.peaks[size_t(band)];
+        auto& peak = settings.peaks[size_t(band)];
+        peak.freq = processorParameters.getRawParameterValue(ids.freq)->load();
+        peak.gain = processorParameters.getRawParameterValue(ids.gain)->load();
+        peak.q = processorParameters.getRawParameterValue(ids.q)->load();
+    }
 
-    settings.lpFilter.cutf = processorParameters.getRawParameterValue("lpFreq")->load();
-    settings.lpFilter.slope = static_cast<Slope>(processorParameters.getRawParameterValue("lpSlope")->load());
+    const auto design = static_cast<Design>(processorParameters.getRawParameterValue("filterDesign")->load());
+    settings.hpFilter.design = settings.lpFilter.design = design;
+    for (auto& peak : settings.peaks)
+        peak.design = design;
 
     return settings;
 }
 
-void updateCoefficients(Coefficients &oldCoeff,const Coefficients &newCoeff)
+const ChannelParameterIDs& getChannelParameterIDs(bool rightChannel)
 {
-    *oldCoeff = *newCoeff;
+    static const auto ids = []
+    {
+        std::array<ChannelParameterIDs, 2> result;
+
+        for (size_t side = 0; side < result.size(); ++side)
+        {
+            const juce::String suffix = side == 0 ? "" : "R";
+            auto& channel = result[side];
+            channel.hpFreq = "hpFreq" + suffix;
+            channel.hpSlope = "hpSlope" + suffix;
+            channel.lpFreq = "lpFreq" + suffix;
+            channel.lpSlope = "lpSlope" + suffix;
+            channel.numBands = "numBands" + suffix;
+
+            for (int band = 0; band < maxPeakBands; ++band)
+            {
+                const auto number = juce::String(band + 1) + suffix;
+                channel.peaks[size_t(band)] = { "peakGain" + number, "peakFreq" + number, "peakQ" + number };
+            }
+        }
+
+        return result;
+    }();
+
+    return ids[rightChannel ? 1 : 0];
+}
+
+const std::array<PeakParameterIDs, maxPeakBands>& getPeakParameterIDs(bool rightChannel)
+{
+    return getChannelParameterIDs(rightChannel).peaks;
 }
 
-Coefficients makePeakFilter(const ChainSettings::PeakFilter& filter, double sampleRate)
+PreciseBiquadCoefficients makePeakFilter(const ChainSettings::PeakFilter& filter, double sampleRate)
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate,
-                                                            filter.freq,
-                                                            filter.q,
-                                                            juce::Decibels::decibelsToGain(filter.gain));
+    // decibelsToGain() rounds the bottom of the gain range, below -100 dB, to
+    // zero, which the design divides by.
+    const auto gainFactor = juce::Decibels::decibelsToGain(double(filter.gain), -1000.0);
+
+    if (filter.design == design_matched)
+        return designMatchedPeak(sampleRate, filter.freq, filter.q, gainFactor);
+
+    const auto a = std::sqrt(gainFactor);
+    const auto omega = juce::MathConstants<double>::twoPi * juce::jlimit(2.0, 0.499 * sampleRate, double(filter.freq)) / sampleRate;
+    const auto alpha = std::sin(omega) / (2.0 * filter.q);
+    const auto c2 = -2.0 * std::cos(omega);
+    const auto a0 = 1.0 + alpha / a;
+
+    return { (1.0 + alpha * a) / a0, c2 / a0, (1.0 - alpha * a) / a0, c2 / a0, (1.0 - alpha / a) / a0 };
 }
 
-void EQ5bAudioProcessor::updatePeakFilters(int position, const ChainSettings::PeakFilter& filter)
-{   
-    auto peakFilterCoefficients = makePeakFilter(filter, getSampleRate());
-    switch (position)
+int makeCutFilter(const ChainSettings::CutFilter& filter, double sampleRate, bool highPass,
+                  PreciseBiquadCoefficients* sections)
+{
+    static_assert(numCutStages == maxButterworthSections, "a cut filter needs a slot per section");
+
+    const auto order = 2 * (filter.slope + 1);
+
+    if (filter.design != design_matched)
+        return designButterworth(sampleRate, filter.cutf, order, highPass, sections);
+
+    // Same sections as the Butterworth design, each matched instead of bilinear.
+    for (int i = 0; i < order / 2; ++i)
     {
-    case ChainPositions::LoPeak:
-        updateCoefficients(leftChain.get<ChainPositions::LoPeak>().coefficients, peakFilterCoefficients);
-        updateCoefficients(rightChain.get<ChainPositions::LoPeak>().coefficients, peakFilterCoefficients);
-        break;
-    
-    case ChainPositions::MidPeak:
-        updateCoefficients(leftChain.get<ChainPositions::MidPeak>().coefficients, peakFilterCoefficients);
-        updateCoefficients(rightChain.get<ChainPositions::MidPeak>().coefficients, peakFilterCoefficients);
-        break;
-
-    case ChainPositions::HiPeak:
-        updateCoefficients(leftChain.get<ChainPositions::HiPeak>().coefficients, peakFilterCoefficients);
-        updateCoefficients(rightChain.get<ChainPositions::HiPeak>().coefficients, peakFilterCoefficients);
-        break;
-
-    default:
-        break;
+        const auto q = getButterworthSectionQ(order, i);
+        sections[i] = highPass ? designMatchedHighPass(sampleRate, filter.cutf, q)
+                               : designMatchedLowPass(sampleRate, filter.cutf, q);
     }
+
+    return order / 2;
 }
 
-void EQ5bAudioProcessor::updateCutFilters(int position, const ChainSettings::CutFilter& filter)
+void updateFilterBank(FilterBank& bank, const ChainSettings& settings, double sampleRate)
 {
-    switch (position)
+    auto setCutStages = [&bank, sampleRate](int firstSlot, const ChainSettings::CutFilter& filter, bool highPass)
+    {
+        const auto numStages = makeCutFilter(filter, sampleRate, highPass, &bank.preciseCoefficients[size_t(firstSlot)]);
+
+        for (int i = 0; i < numCutStages; ++i)
+            bank.active[size_t(firstSlot + i)] = i < numStages;
+    };
+
+    setCutStages(FilterBank::hpSlot, settings.hpFilter, true);
+
+    for (int band = 0; band < maxPeakBands; ++band)
     {
-        case ChainPositions::LoPass:
+        const auto slot = size_t(FilterBank::peakSlot + band);
+        bank.active[slot] = band < settings.numBands;
+
+        if (bank.active[slot])
+            bank.preciseCoefficients[slot] = makePeakFilter(settings.peaks[size_t(band)], sampleRate);
+    }
+
+    setCutStages(FilterBank::lpSlot, settings.lpFilter, false);
+    bank.lowestCutHz = juce::jmin(settings.hpFilter.cutf, settings.lpFilter.cutf);
+
+    for (size_t slot = 0; slot < size_t(FilterBank::numSlots); ++slot)
+        bank.coefficients[slot] = bank.preciseCoefficients[slot].toFloat();
+}
+
+/** Names of the per-side parameters, in the same shape as their IDs. */
+struct ChannelParameterNames
+{
+    juce::String hpFreq, hpSlope, lpFreq, lpSlope, numBands;
+    std::array<juce::String, maxPeakBands> peakGain, peakFreq, peakQ;
+};
+
+// Every instance builds its own parameters, but the strings they hold come
+// from these tables, built once per process, and so share their storage.
+
+static const ChannelParameterNames& getChannelParameterNames(bool rightChannel)
+{
+    static const auto names = []
+    {
+        std::array<ChannelParameterNames, 2> result;
+
+        for (size_t side = 0; side < result.size(); ++side)
         {
-        auto loFilterCoefficients = makeLpFilter(filter, getSampleRate());
-        updateCutFiltersSlope(rightChain.get<ChainPositions::LoPass>(), loFilterCoefficients, filter.slope);
-        updateCutFiltersSlope(leftChain.get<ChainPositions::LoPass>(), loFilterCoefficients, filter.slope);
-        break;
+            const juce::String prefix = side == 0 ? "" : "Right ";
+            auto& channel = result[side];
+            channel.hpFreq = prefix + "HP cut frequency";
+            channel.hpSlope = prefix + "HP Slope";
+            channel.lpFreq = prefix + "LP cut frequency";
+            channel.lpSlope = prefix + "LP Slope";
+            channel.numBands = prefix + "Peak Bands";
+
+            const char* firstBands[][3] = { { "Low Peak Gain", "Low Peak Frequency", "Low Peak Bandwidth" },
+                                            { "Mid Peak gain", "Mid Peak freq", "Mid Peak Bandwidth" },
+                                            { "High Peak gain", "High Peak freq", "High Peak Bandwidth" } };
+
+            for (size_t band = 0; band < size_t(maxPeakBands); ++band)
+            {
+                const auto name = prefix + "Peak " + juce::String(int(band) + 1);
+                channel.peakGain[band] = band < 3 ? prefix + firstBands[band][0] : name + " Gain";
+                channel.peakFreq[band] = band < 3 ? prefix + firstBands[band][1] : name + " Frequency";
+                channel.peakQ[band] = band < 3 ? prefix + firstBands[band][2] : name + " Bandwidth";
+            }
         }
-        case ChainPositions::HiPass:
+
+        return result;
+    }();
+
+    return names[rightChannel ? 1 : 0];
+}
+
+static const juce::StringArray& getSlopeChoices()
+{
+    static const auto choices = []
+    {
+        juce::StringArray strArray;
+        for (int i = 0; i < 4; ++i)
         {
-        auto hiFilterCoefficients = makeHpFilter(filter, getSampleRate());
-        updateCutFiltersSlope(rightChain.get<ChainPositions::HiPass>(), hiFilterCoefficients, filter.slope);
-        updateCutFiltersSlope(leftChain.get<ChainPositions::HiPass>(), hiFilterCoefficients, filter.slope);
-        break;
+            juce::String str;
+            str << (12 + 12 * i);
+            str << " db/Oct";
+            strArray.add(str);
         }
-    }    
+        return strArray;
+    }();
+
+    return choices;
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout EQ5bAudioProcessor::createParameterLayout()
@@ -311,75 +796,154 @@ juce::AudioProcessorValueTreeState::ParameterLayout EQ5bAudioProcessor::createPa
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
     // HP and LP Filters Parameters:
-    juce::StringArray strArray;
-    for (int i = 0; i < 4; ++i)
+    const auto& strArray = getSlopeChoices();
+
+    // The right side's copies of the per-side parameters only apply in dual
+    // mono, and all came with version 19.
+    for (const auto rightChannel : { false, true })
     {
-        juce::String str;
-        str << (12 + 12 * i);
-        str << " db/Oct";
-        strArray.add(str);
-    }
+        const auto& ids = getChannelParameterIDs(rightChannel);
+        const auto& names = getChannelParameterNames(rightChannel);
+        auto version = [rightChannel](int hint) { return rightChannel ? 19 : hint; };
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("hpFreq",1),
-                                                           "HP cut frequency",
-                                                           juce::NormalisableRange<float>(20.f, 500.f, 1.f),
-                                                           20.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.hpFreq,version(1)),
+                                                               names.hpFreq,
+                                                               juce::NormalisableRange<float>(20.f, 500.f, 1.f),
+                                                               20.f));
 
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("hpSlope", 2), "HP Slope", strArray, 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(ids.hpSlope, version(2)), names.hpSlope, strArray, 0));
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("lpFreq", 3),
-                                                           "LP cut frequency",
-                                                           juce::NormalisableRange<float>(1000.f, 20000.f, 1.f),
-                                                           20000.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.lpFreq, version(3)),
+                                                               names.lpFreq,
+                                                               juce::NormalisableRange<float>(1000.f, 20000.f, 1.f),
+                                                               20000.f));
 
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("lpSlope",4), "LP Slope", strArray, 0));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(ids.lpSlope,version(4)), names.lpSlope, strArray, 0));
 
-    // Peak Filters
+        // Peak Filters
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakGain1",5),
-                                                           "Low Peak Gain",
-                                                           juce::NormalisableRange<float>(-120.0f, 12.0f, 1.f, 3.f),
-                                                           0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[0].gain,version(5)),
+                                                               names.peakGain[0],
+                                                               juce::NormalisableRange<float>(-120.0f, 12.0f, 1.f, 3.f),
+                                                               0.0f));
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakFreq1",6),
-                                                           "Low Peak Frequency",
-                                                           juce::NormalisableRange<float>(100.f, 700.f, 1.f),
-                                                           300.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[0].freq,version(6)),
+                                                               names.peakFreq[0],
+                                                               juce::NormalisableRange<float>(100.f, 700.f, 1.f),
+                                                               300.0f));
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakQ1",7),
-                                                           "Low Peak Bandwidth",
-                                                           juce::NormalisableRange<float>(0.1f, 4.f, 0.01f),
-                                                           1.f));
-    
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakGain2",8),
-                                                            "Mid Peak gain",
-                                                            juce::NormalisableRange<float>(-120.f, 12.f, 1.f, 3.f),
-                                                            0.0f));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakFreq2",9),
-                                                            "Mid Peak freq",
-                                                            juce::NormalisableRange(600.f, 3200.f, 1.f),
-                                                            500.f));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakQ2",10),
-                                                            "Mid Peak Bandwidth",
-                                                            juce::NormalisableRange(0.1f, 4.f, 0.01f),
-                                                            1.f));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakGain3",11),
-                                                            "High Peak gain",
-                                                            juce::NormalisableRange<float>(-120.f, 12.f, 1.f, 3.f),
-                                                            0.0f));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakFreq3",12),
-                                                            "High Peak freq",
-                                                            juce::NormalisableRange(2500.f, 15000.f, 1.f),
-                                                            500.f));
-
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("peakQ3",13),
-                                                            "High Peak Bandwidth",
-                                                            juce::NormalisableRange(0.1f, 4.f, 0.01f),
-                                                            1.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[0].q,version(7)),
+                                                               names.peakQ[0],
+                                                               juce::NormalisableRange<float>(0.1f, 4.f, 0.01f),
+                                                               1.f));
+        
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[1].gain,version(8)),
+                                                                names.peakGain[1],
+                                                                juce::NormalisableRange<float>(-120.f, 12.f, 1.f, 3.f),
+                                                                0.0f));
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[1].freq,version(9)),
+                                                                names.peakFreq[1],
+                                                                juce::NormalisableRange(600.f, 3200.f, 1.f),
+                                                                500.f));
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[1].q,version(10)),
+                                                                names.peakQ[1],
+                                                                juce::NormalisableRange(0.1f, 4.f, 0.01f),
+                                                                1.f));
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[2].gain,version(11)),
+                                                                names.peakGain[2],
+                                                                juce::NormalisableRange<float>(-120.f, 12.f, 1.f, 3.f),
+                                                                0.0f));
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[2].freq,version(12)),
+                                                                names.peakFreq[2],
+                                                                juce::NormalisableRange(2500.f, 15000.f, 1.f),
+                                                                500.f));
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(ids.peaks[2].q,version(13)),
+                                                                names.peakQ[2],
+                                                                juce::NormalisableRange(0.1f, 4.f, 0.01f),
+                                                                1.f));
+
+        // Bands beyond the first three span the whole range and are only processed
+        // while "numBands" includes them.
+
+        for (int band = 4; band <= maxPeakBands; ++band)
+        {
+            const auto& peakIDs = ids.peaks[size_t(band - 1)];
+            const auto defaultFreq = juce::mapToLog10((band - 3.5f) / float(maxPeakBands - 3), 20.f, 20000.f);
+
+            layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(peakIDs.gain,version(16)),
+                                                                    names.peakGain[size_t(band - 1)],
+                                                                    juce::NormalisableRange<float>(-120.f, 12.f, 1.f, 3.f),
+                                                                    0.0f));
+
+            layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(peakIDs.freq,version(16)),
+                                                                    names.peakFreq[size_t(band - 1)],
+                                                                    juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                                    defaultFreq));
+
+            layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(peakIDs.q,version(16)),
+                                                                    names.peakQ[size_t(band - 1)],
+                                                                    juce::NormalisableRange(0.1f, 4.f, 0.01f),
+                                                                    1.f));
+        }
+
+        layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID(ids.numBands,version(16)),
+                                                              names.numBands,
+                                                              0, maxPeakBands, 3));
+    }
+
+    // Dual mono gives the right channel of a stereo bus the "R" parameters and
+    // a loudness match of its own; other buses always run linked.
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("stereoMode",19),
+                                                            "Stereo Mode",
+                                                            juce::StringArray("Linked", "Dual Mono"),
+                                                            0));
+
+    // Auto renders offline bounces with matched sections in cascade form and
+    // plays back with the design and form chosen above; the other two choices
+    // hold one tier.
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("quality",20),
+                                                            "Quality",
+                                                            juce::StringArray("Auto", "Realtime", "Offline"),
+                                                            0));
+
+    // Moves between the stored snapshots, first to last, in place of the
+    // settings above while engaged.
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("morph",21),
+                                                           "Morph",
+                                                           juce::NormalisableRange<float>(0.f, 1.f),
+                                                           0.f));
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("morphEngaged",21),
+                                                          "Morph Engaged",
+                                                          false));
+
+    // Filter engine
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("filterForm",14),
+                                                            "Filter Form",
+                                                            juce::StringArray("Cascade", "Parallel"),
+                                                            0));
+
+    // Matched sections follow the analog curves up to Nyquist without oversampling.
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("filterDesign",15),
+                                                            "Filter Design",
+                                                            juce::StringArray("Bilinear", "Matched"),
+                                                            0));
+
+    // Splits wide buses into channel groups filtered on pinned worker threads.
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("channelThreads",17),
+                                                          "Channel Threads",
+                                                          false));
+
+    // Keeps the K-weighted loudness of the output at that of the input.
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("autoGain",18),
+                                                          "Auto Gain",
+                                                          false));
 
     return layout;
 }
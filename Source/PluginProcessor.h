@@ -9,6 +9,14 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BlockIIR.h"
+#include "ChannelWorkerPool.h"
+#include "MidiControl.h"
+#include "SignalMeters.h"
+#include "Trace.h"
+
+constexpr int maxPeakBands = 24;
+constexpr int numCutStages = 4;
 
 enum Slope {
   slope_12,
@@ -17,91 +25,101 @@ enum Slope {
   slope_48
 };
 
+enum Design {
+  design_bilinear,
+  design_matched
+};
+
+enum StereoMode {
+  stereo_linked,
+  stereo_dualMono
+};
+
+enum QualityTier {
+  quality_auto,
+  quality_realtime,
+  quality_offline
+};
+
 struct ChainSettings{
   struct CutFilter{
     float cutf{0};
     Slope slope{slope_12};
+    Design design{design_bilinear};
   };
   CutFilter lpFilter, hpFilter;
   struct PeakFilter{
     float gain{0}, q{0}, freq{0};
+    Design design{design_bilinear};
   };
-  PeakFilter loPeak, midPeak, hiPeak;
+  std::array<PeakFilter, maxPeakBands> peaks;
+  int numBands{3};
 };
 
-using Filter = juce::dsp::IIR::Filter<float>;
-using CutFreq = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-using MonoChain = juce::dsp::ProcessorChain<CutFreq, Filter, Filter, Filter, CutFreq>;
+/** Every section of the EQ in processing order - the HP stages, the peak
+    bands, then the LP stages - in one contiguous array. Slots that the
+    slopes or the band count leave unused are marked inactive. The
+    coefficients are rounded from the designers' preciseCoefficients, which
+    the sections that run in double precision use as they are. lowestCutHz is
+    the lower of the two cut-offs, which the new sections of a slope or band
+    count change take the longest to settle on.
+*/
+struct FilterBank
+{
+  static constexpr int hpSlot = 0;
+  static constexpr int peakSlot = hpSlot + numCutStages;
+  static constexpr int lpSlot = peakSlot + maxPeakBands;
+  static constexpr int numSlots = lpSlot + numCutStages;
+
+  std::array<BiquadCoefficients, numSlots> coefficients {};
+  std::array<PreciseBiquadCoefficients, numSlots> preciseCoefficients {};
+  std::array<bool, numSlots> active {};
+  float lowestCutHz = 0;
+};
 
-enum ChainPositions{
-HiPass,
-LoPeak,
-MidPeak,
-HiPeak,
-LoPass
+struct PeakParameterIDs{
+  juce::String gain, freq, q;
 };
 
-using Coefficients = Filter::CoefficientsPtr;
-void updateCoefficients (Coefficients& oldCoeff, const Coefficients& newCoeff);
+/** The parameters each side of a stereo bus has its own copy of. */
+struct ChannelParameterIDs{
+  juce::String hpFreq, hpSlope, lpFreq, lpSlope, numBands;
+  std::array<PeakParameterIDs, maxPeakBands> peaks;
+};
 
-Coefficients makePeakFilter (const ChainSettings::PeakFilter& filter, double sampleRate);
-ChainSettings getChainSettings (juce::AudioProcessorValueTreeState& processorParameters);
+/** "hpFreq", "peakGain1" ... for the left side and linked stereo; the right
+    side's copies, which only apply in dual mono, end in "R".
+*/
+const ChannelParameterIDs& getChannelParameterIDs (bool rightChannel = false);
 
-template<int Index, typename ChainType, typename CoeffincientType>
-void update(ChainType& chain, const CoeffincientType& coefficients)
-{
-  updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
-  chain.template setBypassed<Index>(false);  
-}
-
-template<typename ChainType, typename CoefficientType>
-void updateCutFiltersSlope(ChainType& chain,
-                    const CoefficientType& cutCoefficients,
-                    const Slope& slope)
-{
-  chain.template setBypassed<0>(true);
-  chain.template setBypassed<1>(true);
-  chain.template setBypassed<2>(true);
-  chain.template setBypassed<3>(true);
-
-  switch ( slope )
-  {
-  case slope_48:
-    {
-      update<3>(chain, cutCoefficients);
-    }
-  case slope_36:
-    {
-      update<2>(chain, cutCoefficients);
-    }
-  case slope_24:
-    {
-      update<1>(chain, cutCoefficients);
-    }
-  case slope_12:
-    {
-      update<0>(chain, cutCoefficients);
-    }
-  }
-}
-
-inline auto makeLpFilter(const ChainSettings::CutFilter& filter, double sampleRate)
-{
-  return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(filter.cutf,
-                                                                            sampleRate,
-                                                                            2*(filter.slope+1));
-}
+/** "peakGain1", "peakFreq1", "peakQ1" ... for every band. */
+const std::array<PeakParameterIDs, maxPeakBands>& getPeakParameterIDs (bool rightChannel = false);
+
+/** The bilinear design is the RBJ peak of juce::dsp::IIR::Coefficients,
+    computed in double and returned inline rather than in a heap object.
+*/
+PreciseBiquadCoefficients makePeakFilter (const ChainSettings::PeakFilter& filter, double sampleRate);
+
+/** Designs the numCutStages or fewer sections of a cut filter into sections
+    and returns how many there are. Allocates nothing.
+*/
+int makeCutFilter (const ChainSettings::CutFilter& filter, double sampleRate, bool highPass,
+                   PreciseBiquadCoefficients* sections);
+ChainSettings getChainSettings (juce::AudioProcessorValueTreeState& processorParameters,
+                                bool rightChannel = false);
+
+/** Designs the first numBands peaks and the stages each slope needs. */
+void updateFilterBank (FilterBank& bank, const ChainSettings& settings, double sampleRate);
+class FilterCascade;
+class ResponseSnapshot;
+class SnapshotMorph;
 
-inline auto makeHpFilter(const ChainSettings::CutFilter& filter, double sampleRate)
-{
-  return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(filter.cutf,
-                                                                            sampleRate,
-                                                                            2*(filter.slope+1));
-}
 //==============================================================================
 /**
 */
-class EQ5bAudioProcessor  : public juce::AudioProcessor
+class EQ5bAudioProcessor  : public juce::AudioProcessor,
+                            private juce::AudioProcessorValueTreeState::Listener,
+                            private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -143,14 +161,96 @@ public:
 
     //==============================================================================
 
+    /** The response the engine runs for the current parameters and quality
+        tier, at the current sample rate.
+        Safe to call from any thread; see ResponseSnapshot for the queries.
+    */
+    ResponseSnapshot getResponseSnapshot (bool rightChannel = false);
+
+    /** Stores the current settings of both sides as morph snapshot index.
+        Message thread.
+    */
+    void storeSnapshot (int index);
+    SnapshotMorph& getSnapshotMorph() noexcept { return *snapshotMorph; }
+
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState processorParameters{*this, nullptr, "Parameters", createParameterLayout()};
+    MidiControl midiControl;
+    SignalMeters signalMeters;
 private:
-    using Coefficients = Filter::CoefficientsPtr;
-    MonoChain leftChain, rightChain;
+    /** CCs closer than this to the last split take effect with it, so a dense
+        stream costs at most one redesign per minSplitSamples.
+    */
+    static constexpr int minSplitSamples = 32;
+
+    void processSegment (juce::dsp::AudioBlock<float> segment, bool dualMono, bool morphing);
+
+    /** Runs the block through the morph, ramping it to morphEnd, or through
+        the cascades.
+    */
+    void processPath (juce::dsp::AudioBlock<float> block, bool dualMono, bool morphing, float morphEnd);
+
+    juce::SharedResourcePointer<Trace::Session> traceSession;
+
+    /** The worker pool starts real-time threads, so instances only share it
+        once "channelThreads" has been on: it is created on the message thread,
+        or in prepareToPlay, and the audio thread runs every channel inline
+        until it exists. The right cascade of dual mono is created the same
+        way once "stereoMode" has been set to it on a stereo bus, and the
+        audio thread runs linked stereo until it exists; so is the cascades'
+        parallel form designer once "filterForm" has been set to parallel,
+        and they run in cascade form until it exists.
+    */
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    void createChannelWorkers();
+    void createRightCascade (double sampleRate);
+    void startParallelDesigners();
+
+    juce::CriticalSection channelWorkersLock;   // prepareToPlay and the message thread
+    std::unique_ptr<juce::SharedResourcePointer<ChannelWorkerPool>> channelWorkerPool;
+    std::atomic<ChannelWorkerPool*> channelWorkers { nullptr };
+
+    bool isDualMonoSelected();
+
+    /** True while the engine trades CPU for accuracy: always, never, or while
+        the host renders offline, as the "quality" parameter says.
+    */
+    bool isUsingOfflineTier();
+
+    /** The parameters as the engine runs them after the quality tier. */
+    ChainSettings getEngineSettings (bool rightChannel);
+    void updateCascade (FilterCascade& target, FilterBank& bank, bool rightChannel);
+
+    // In dual mono the right channel of a stereo bus runs its own cascade on
+    // its own parameters; otherwise every channel runs the left one. Mono and
+    // linked stereo instances never create the right cascade.
+    FilterBank filterBank, rightFilterBank;
+    std::unique_ptr<FilterCascade> cascade, rightCascadeObject;
+    juce::CriticalSection rightCascadeLock;     // prepareToPlay and the message thread
+    std::atomic<FilterCascade*> rightCascade { nullptr };
+    bool processedDualMono = false;
+
+    // While "morphEngaged" is on and two snapshots are stored, the morph runs
+    // in place of the cascades; lastMorph is where the previous segment ended.
+    std::unique_ptr<SnapshotMorph> snapshotMorph;
+    bool processedMorphing = false;
+    float lastMorph = 0.f;
+
+    // Engaging the morph, or releasing it, hands over as a FilterCascade
+    // transition does: the path taking over starts from silence and settles
+    // on the same input while the other is still heard, for handOverCycles of
+    // its lowest cut-off but at least handOverSeconds, then the output
+    // crossfades to it over handOverFadeSeconds. The outgoing path runs on a
+    // copy of the input in handOverBuffer.
+    static constexpr double handOverSeconds = 0.025;
+    static constexpr double handOverCycles = 2.0;
+    static constexpr double handOverFadeSeconds = 0.01;
+
+    juce::AudioBuffer<float> handOverBuffer;
+    int handOverWarmUp = 0, handOverFade = 1;
+    int handOverPosition = -1;
 
-    void updatePeakFilters(int position, const ChainSettings::PeakFilter& filter);
-    void updateCutFilters(int position, const ChainSettings::CutFilter& filter);
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EQ5bAudioProcessor)
 };
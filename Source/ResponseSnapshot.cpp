@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    ResponseSnapshot.cpp
+    Magnitude, phase and group delay of the EQ at any set of frequencies.
+
+  ==============================================================================
+*/
+
+#include "ResponseSnapshot.h"
+#include "FilterCascade.h"
+
+ResponseSnapshot::ResponseSnapshot (const FilterBank& bank, double designSampleRate) noexcept
+  : sampleRate (designSampleRate)
+{
+  // Without a sample rate there is nothing to evaluate; the response stays flat.
+  if (sampleRate > 0.0)
+    numSections = getActiveSections (bank, sections);
+}
+
+ResponseSnapshot::ResponseSnapshot (const ChainSettings& settings, double designSampleRate)
+  : sampleRate (designSampleRate)
+{
+  if (sampleRate > 0.0)
+  {
+    FilterBank bank;
+    updateFilterBank (bank, settings, sampleRate);
+    numSections = getActiveSections (bank, sections);
+  }
+}
+
+void ResponseSnapshot::getResponse (const float* frequencies, size_t count,
+                                    float* magnitudes, float* phases, float* groupDelays) const noexcept
+{
+  const auto& kernels = DSPKernels::get();
+  const auto radiansPerHz = sampleRate > 0.0 ? juce::MathConstants<double>::twoPi / sampleRate : 0.0;
+  const auto secondsPerSample = sampleRate > 0.0 ? (float) (1.0 / sampleRate) : 0.f;
+
+  float phi[chunkSize], sinOmega[chunkSize];
+
+  for (size_t start = 0; start < count; start += chunkSize)
+  {
+    const auto n = juce::jmin (chunkSize, count - start);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      const auto omega = radiansPerHz * (double) frequencies[start + i];
+      const auto sinHalf = std::sin (0.5 * omega);
+      phi[i] = (float) (sinHalf * sinHalf);
+      sinOmega[i] = (float) std::sin (omega);
+    }
+
+    kernels.frequencyResponse (sections.data(), numSections, phi, sinOmega,
+                               magnitudes != nullptr ? magnitudes + start : nullptr,
+                               phases != nullptr ? phases + start : nullptr,
+                               groupDelays != nullptr ? groupDelays + start : nullptr, n);
+
+    if (groupDelays != nullptr)
+      for (size_t i = 0; i < n; ++i)
+        groupDelays[start + i] *= secondsPerSample;
+  }
+}
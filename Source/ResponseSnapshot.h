@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    ResponseSnapshot.h
+    Magnitude, phase and group delay of the EQ at any set of frequencies.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+/** A copy of the active sections of a FilterBank and the sample rate they were
+    designed for. It never changes after construction, so one snapshot can be
+    queried from any number of threads at once, and queries allocate nothing.
+
+    Queries run on the frequencyResponse kernel, vectorised across the
+    frequencies, in chunks of chunkSize; the only per-frequency trigonometry
+    is the sin w and sin^2 (w / 2) each chunk is evaluated at.
+*/
+class ResponseSnapshot
+{
+public:
+  static constexpr size_t chunkSize = 256;
+
+  /** A flat response. */
+  ResponseSnapshot() = default;
+
+  ResponseSnapshot (const FilterBank& bank, double designSampleRate) noexcept;
+
+  /** Designs the bank for the settings first, so this may allocate. */
+  ResponseSnapshot (const ChainSettings& settings, double designSampleRate);
+
+  double getSampleRate() const noexcept { return sampleRate; }
+  int getNumSections() const noexcept { return numSections; }
+
+  /** Fills the outputs for count frequencies in Hz: linear magnitudes, phases
+      in radians wrapped to (-pi, pi], and group delays in seconds. Any output
+      may be nullptr.
+  */
+  void getResponse (const float* frequencies, size_t count,
+                    float* magnitudes, float* phases, float* groupDelays) const noexcept;
+
+private:
+  std::array<BiquadCoefficients, FilterBank::numSlots> sections {};
+  int numSections = 0;
+  double sampleRate = 0.0;
+};
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    SIMDLanes.h
+    Minimal SIMD register built on GCC/Clang vector extensions, for the
+    per-instruction-set kernel translation units.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+template <size_t NumLanes> struct NativeFloatVector;
+template <> struct NativeFloatVector<4>  { typedef float Type __attribute__ ((vector_size (16))); };
+template <> struct NativeFloatVector<8>  { typedef float Type __attribute__ ((vector_size (32))); };
+template <> struct NativeFloatVector<16> { typedef float Type __attribute__ ((vector_size (64))); };
+
+/** Offers the subset of the juce::dsp::SIMDRegister<float> interface used by
+    the kernels in BlockIIR.h, ParallelForm.h, MagnitudeResponse.h and
+    LevelMeter.h.
+
+    The kernel translation units are compiled with different -m flags, so
+    every instantiation must stay private to its own file: each one passes a
+    Tag type declared in an anonymous namespace, which gives the register and
+    every kernel instantiated with it internal linkage. Nothing here may call
+    an inline function with external linkage.
+*/
+template <size_t NumLanes, typename Tag>
+struct FloatLanes
+{
+  static constexpr size_t SIMDNumElements = NumLanes;
+
+  using NativeType = typename NativeFloatVector<NumLanes>::Type;
+  NativeType value;
+
+  static FloatLanes expand (float s) noexcept             { return { NativeType {} + s }; }
+
+  static FloatLanes fromRawArray (const float* a) noexcept
+  {
+    FloatLanes r;
+    std::memcpy (&r.value, a, sizeof (NativeType));
+    return r;
+  }
+
+  void copyToRawArray (float* a) const noexcept           { std::memcpy (a, &value, sizeof (NativeType)); }
+
+  static FloatLanes multiplyAdd (FloatLanes a, FloatLanes b, FloatLanes c) noexcept
+  {
+    return { a.value + b.value * c.value };
+  }
+
+  FloatLanes operator+ (FloatLanes o) const noexcept      { return { value + o.value }; }
+  FloatLanes operator- (FloatLanes o) const noexcept      { return { value - o.value }; }
+  FloatLanes operator* (FloatLanes o) const noexcept      { return { value * o.value }; }
+
+  static FloatLanes max (FloatLanes a, FloatLanes b) noexcept { return { a.value > b.value ? a.value : b.value }; }
+  static FloatLanes abs (FloatLanes a) noexcept            { return { a.value < 0 ? -a.value : a.value }; }
+
+  /** Not part of SIMDRegister; only FrequencyResponseKernel divides. */
+  FloatLanes operator/ (FloatLanes o) const noexcept      { return { value / o.value }; }
+
+  float sum() const noexcept
+  {
+    float s = 0;
+    for (size_t i = 0; i < NumLanes; ++i)
+      s += value[i];
+    return s;
+  }
+};
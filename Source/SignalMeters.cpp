@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    SignalMeters.cpp
+    Input and output peak, RMS and stereo correlation, measured on the audio
+    thread and read by the editor or a host without locking.
+
+  ==============================================================================
+*/
+
+#include "SignalMeters.h"
+
+void SignalMeters::prepare (double newSampleRate, int numChannels) noexcept
+{
+  sampleRate = newSampleRate;
+  measuredChannels.store (juce::jlimit (0, 2, numChannels));
+
+  // The counts keep growing, so that no reader's position runs ahead of them.
+  for (auto* meter : { &input, &output })
+  {
+    for (auto& peaks : meter->peaks)
+      for (auto& peak : peaks)
+        peak.store (0.f);
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+      meter->rms[channel].store (0.f);
+      meter->energy[channel] = 0;
+    }
+
+    meter->correlation.store (0.f);
+    meter->sums = {};
+    meter->numSamples = 0;
+    meter->cross = 0;
+  }
+}
+
+void SignalMeters::add (Stage stage, const juce::dsp::AudioBlock<float>& block) noexcept
+{
+  const auto numChannels = juce::jmin ((int) block.getNumChannels(), measuredChannels.load (std::memory_order_relaxed));
+  const auto numSamples = block.getNumSamples();
+
+  if (numChannels == 0 || numSamples == 0)
+    return;
+
+  auto& meter = getMeter (stage);
+  kernels.measureLevels (block.getChannelPointer (0), numChannels > 1 ? block.getChannelPointer (1) : nullptr,
+                         numSamples, meter.sums);
+
+  meter.numSamples += numSamples;
+  meter.numChannels = numChannels;
+}
+
+void SignalMeters::publish() noexcept
+{
+  publish (input);
+  publish (output);
+}
+
+void SignalMeters::publish (Meter& meter) noexcept
+{
+  if (meter.numSamples == 0)
+    return;
+
+  const auto numChannels = meter.numChannels;
+  const auto& sums = meter.sums;
+
+  // The same one-pole smoothing whatever the block size: each block moves the
+  // averages by the share of rmsSeconds it covers.
+  const auto alpha = 1.0 - std::exp (-(double) meter.numSamples / (rmsSeconds * sampleRate));
+  const auto invSamples = 1.0 / (double) meter.numSamples;
+
+  const auto index = meter.numPublished.load (std::memory_order_relaxed);
+  auto& peaks = meter.peaks[index % peakHistory];
+
+  for (int channel = 0; channel < 2; ++channel)
+    peaks[(size_t) channel].store (channel < numChannels ? sums.peak[channel] : 0.f, std::memory_order_relaxed);
+
+  for (int channel = 0; channel < numChannels; ++channel)
+  {
+    meter.energy[channel] += alpha * (sums.energy[channel] * invSamples - meter.energy[channel]);
+    meter.rms[channel].store ((float) std::sqrt (meter.energy[channel]), std::memory_order_relaxed);
+  }
+
+  meter.cross += alpha * (sums.cross * invSamples - meter.cross);
+
+  // Below about -140 dBFS on either side there is nothing to correlate.
+  const auto energyProduct = meter.energy[0] * meter.energy[1];
+  const auto correlation = numChannels > 1 && energyProduct > 1e-28
+                             ? juce::jlimit (-1.0, 1.0, meter.cross / std::sqrt (energyProduct))
+                             : 0.0;
+
+  meter.correlation.store ((float) correlation, std::memory_order_relaxed);
+  meter.numPublished.store (index + 1, std::memory_order_release);
+
+  meter.sums = {};
+  meter.numSamples = 0;
+}
+
+SignalMeters::Reading SignalMeters::read (Stage stage, ReadPosition& position) const noexcept
+{
+  const auto& meter = getMeter (stage);
+  auto& numRead = position.numRead[stage == Stage::input ? 0 : 1];
+  Reading reading;
+
+  reading.numChannels = measuredChannels.load (std::memory_order_relaxed);
+
+  // A reader that fell further behind gets the whole history; a block
+  // published meanwhile over the oldest entry only adds a newer peak.
+  const auto numPublished = meter.numPublished.load (std::memory_order_acquire);
+  const auto numUnread = juce::jmin (numPublished - numRead, peakHistory);
+
+  for (juce::uint32 i = 1; i <= numUnread; ++i)
+  {
+    const auto& peaks = meter.peaks[(numPublished - i) % peakHistory];
+
+    for (int channel = 0; channel < 2; ++channel)
+      reading.peak[channel] = juce::jmax (reading.peak[channel], peaks[(size_t) channel].load (std::memory_order_relaxed));
+  }
+
+  numRead = numPublished;
+
+  for (int channel = 0; channel < 2; ++channel)
+    reading.rms[channel] = meter.rms[channel].load (std::memory_order_relaxed);
+
+  reading.correlation = meter.correlation.load (std::memory_order_relaxed);
+  return reading;
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    SignalMeters.h
+    Input and output peak, RMS and stereo correlation, measured on the audio
+    thread and read by the editor or a host without locking.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+
+/** The audio thread adds each block to both stages with DSPKernels::
+    measureLevels, in chunks small enough to still be in cache: FilterCascade
+    measures each chunk right before and after running it. At the end of the
+    block, publish() smooths the energies over rmsSeconds and stores the
+    results in atomics.
+
+    The peak of every published block goes into a short history, numbered by
+    a count that only grows. Each reader keeps a ReadPosition and gets the
+    highest peak of the blocks published since its own previous read, so no
+    block is missed however rarely it comes and readers do not take peaks
+    from each other; any decay or hold is up to the reader.
+
+    Only the first two channels are measured.
+*/
+class SignalMeters
+{
+public:
+  enum class Stage
+  {
+    input,
+    output
+  };
+
+  struct Reading
+  {
+    float peak[2] {};         // linear, since this reader's previous read
+    float rms[2] {};          // linear
+    float correlation = 0;    // -1 to 1; 0 for mono or silence
+    int numChannels = 0;
+  };
+
+  /** How far one reader has read each stage. */
+  struct ReadPosition
+  {
+    juce::uint32 numRead[2] {};
+  };
+
+  /** Call before processing, from the thread that processes. */
+  void prepare (double sampleRate, int numChannels) noexcept;
+
+  /** Audio thread: adds all or part of a block to what the stage has
+      measured since the last publish().
+  */
+  void add (Stage stage, const juce::dsp::AudioBlock<float>& block) noexcept;
+
+  /** Audio thread: publishes both stages once the whole block has been added. */
+  void publish() noexcept;
+
+  /** Any thread other than the audio thread. */
+  Reading read (Stage stage, ReadPosition& position) const noexcept;
+
+private:
+  static constexpr double rmsSeconds = 0.3;
+
+  /** Blocks a reader can fall behind by before it misses peaks: at 30 Hz,
+      blocks down to 8 samples at 48 kHz.
+  */
+  static constexpr juce::uint32 peakHistory = 256;
+
+  struct Meter
+  {
+    std::array<std::array<std::atomic<float>, 2>, peakHistory> peaks {};
+    std::atomic<juce::uint32> numPublished { 0 };
+    std::atomic<float> rms[2] {}, correlation { 0.f };
+
+    // Audio thread only.
+    LevelSums sums;
+    size_t numSamples = 0;
+    int numChannels = 0;
+    double energy[2] {}, cross = 0;
+  };
+
+  Meter& getMeter (Stage stage) noexcept { return stage == Stage::input ? input : output; }
+  const Meter& getMeter (Stage stage) const noexcept { return stage == Stage::input ? input : output; }
+  void publish (Meter& meter) noexcept;
+
+  Meter input, output;
+  double sampleRate = 48000.0;
+  std::atomic<int> measuredChannels { 0 };
+
+  const DSPKernels& kernels = DSPKernels::get();
+};
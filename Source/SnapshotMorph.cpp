@@ -0,0 +1,434 @@
+/*
+  ==============================================================================
+
+    SnapshotMorph.cpp
+    Up to four stored settings of the EQ and a morph between them, run as
+    state variable filters whose gains are interpolated per control interval.
+
+  ==============================================================================
+*/
+
+#include "SnapshotMorph.h"
+
+const juce::Identifier SnapshotMorph::stateType ("SnapshotMorph");
+
+namespace
+{
+  const juce::Identifier snapshotType ("Snapshot");
+  const juce::Identifier indexProperty ("index");
+  const juce::Identifier designProperty ("filterDesign");
+
+  void writeSettings (juce::ValueTree& tree, const ChainSettings& settings, bool rightChannel)
+  {
+    const auto& ids = getChannelParameterIDs (rightChannel);
+
+    tree.setProperty (ids.hpFreq, settings.hpFilter.cutf, nullptr);
+    tree.setProperty (ids.hpSlope, (int) settings.hpFilter.slope, nullptr);
+    tree.setProperty (ids.lpFreq, settings.lpFilter.cutf, nullptr);
+    tree.setProperty (ids.lpSlope, (int) settings.lpFilter.slope, nullptr);
+    tree.setProperty (ids.numBands, settings.numBands, nullptr);
+
+    for (int band = 0; band < settings.numBands; ++band)
+    {
+      const auto& peakIDs = ids.peaks[(size_t) band];
+      const auto& peak = settings.peaks[(size_t) band];
+      tree.setProperty (peakIDs.gain, peak.gain, nullptr);
+      tree.setProperty (peakIDs.freq, peak.freq, nullptr);
+      tree.setProperty (peakIDs.q, peak.q, nullptr);
+    }
+  }
+
+  ChainSettings readSettings (const juce::ValueTree& tree, bool rightChannel)
+  {
+    const auto& ids = getChannelParameterIDs (rightChannel);
+    const auto design = static_cast<Design> ((int) tree.getProperty (designProperty, (int) design_bilinear));
+
+    ChainSettings settings;
+    settings.hpFilter = { (float) tree.getProperty (ids.hpFreq, 20.f),
+                          static_cast<Slope> (juce::jlimit (0, (int) slope_48, (int) tree.getProperty (ids.hpSlope, 0))),
+                          design };
+    settings.lpFilter = { (float) tree.getProperty (ids.lpFreq, 20000.f),
+                          static_cast<Slope> (juce::jlimit (0, (int) slope_48, (int) tree.getProperty (ids.lpSlope, 0))),
+                          design };
+    settings.numBands = juce::jlimit (0, maxPeakBands, (int) tree.getProperty (ids.numBands, 0));
+
+    for (int band = 0; band < settings.numBands; ++band)
+    {
+      const auto& peakIDs = ids.peaks[(size_t) band];
+      auto& peak = settings.peaks[(size_t) band];
+      peak.gain = tree.getProperty (peakIDs.gain, 0.f);
+      peak.freq = tree.getProperty (peakIDs.freq, 1000.f);
+      peak.q = tree.getProperty (peakIDs.q, 1.f);
+    }
+
+    for (auto& peak : settings.peaks)
+      peak.design = design;
+
+    return settings;
+  }
+}
+
+//==============================================================================
+SvfCoefficients SvfCoefficients::fromBiquad (const BiquadCoefficients& biquad) noexcept
+{
+  // With the poles inside the unit circle, 1 + a1 + a2 and 1 - a1 + a2 are
+  // positive and a2 is below one; the floor keeps g and k finite and positive
+  // for designs that rounded onto the circle.
+  constexpr double minimum = 1.0e-12;
+
+  const auto a1 = (double) biquad.a1, a2 = juce::jmin ((double) biquad.a2, 1.0 - minimum);
+  const auto b0 = (double) biquad.b0, b1 = (double) biquad.b1, b2 = (double) biquad.b2;
+  const auto atDC = juce::jmax (1.0 + a1 + a2, minimum);
+  const auto atNyquist = juce::jmax (1.0 - a1 + a2, minimum);
+
+  SvfCoefficients svf;
+  svf.g = std::sqrt (atDC / atNyquist);
+  svf.k = 2.0 * (1.0 - a2) / (atNyquist * svf.g);
+  svf.m0 = (b0 - b1 + b2) / atNyquist;
+  svf.m1 = 2.0 * (b0 - b2) / (atNyquist * svf.g);
+  svf.m2 = (b0 + b1 + b2) / atDC;
+  return svf;
+}
+
+//==============================================================================
+void SnapshotMorph::store (int index, const ChainSettings& left, const ChainSettings& right)
+{
+  jassert (juce::isPositiveAndBelow (index, maxSnapshots));
+
+  const juce::ScopedLock sl (designLock);
+  snapshots.stored[(size_t) index] = true;
+  snapshots.settings[(size_t) index] = { left, right };
+  publish();
+}
+
+void SnapshotMorph::clear (int index)
+{
+  jassert (juce::isPositiveAndBelow (index, maxSnapshots));
+
+  const juce::ScopedLock sl (designLock);
+  snapshots.stored[(size_t) index] = false;
+  publish();
+}
+
+bool SnapshotMorph::isStored (int index) const noexcept
+{
+  return juce::isPositiveAndBelow (index, maxSnapshots) && snapshots.stored[(size_t) index];
+}
+
+void SnapshotMorph::publish()
+{
+  design (snapshots, sampleRate, published.getWriteBuffer());
+  published.publish();
+}
+
+juce::ValueTree SnapshotMorph::toValueTree() const
+{
+  juce::ValueTree tree (stateType);
+
+  for (int index = 0; index < maxSnapshots; ++index)
+  {
+    if (! snapshots.stored[(size_t) index])
+      continue;
+
+    const auto& settings = snapshots.settings[(size_t) index];
+    juce::ValueTree snapshot (snapshotType);
+    snapshot.setProperty (indexProperty, index, nullptr);
+    snapshot.setProperty (designProperty, (int) settings[0].hpFilter.design, nullptr);
+    writeSettings (snapshot, settings[0], false);
+    writeSettings (snapshot, settings[1], true);
+    tree.appendChild (snapshot, nullptr);
+  }
+
+  return tree;
+}
+
+void SnapshotMorph::fromValueTree (const juce::ValueTree& tree)
+{
+  const juce::ScopedLock sl (designLock);
+  snapshots.stored.fill (false);
+
+  for (const auto snapshot : tree)
+  {
+    const auto index = (int) snapshot.getProperty (indexProperty, -1);
+
+    if (! snapshot.hasType (snapshotType) || ! juce::isPositiveAndBelow (index, maxSnapshots))
+      continue;
+
+    snapshots.stored[(size_t) index] = true;
+    snapshots.settings[(size_t) index] = { readSettings (snapshot, false), readSettings (snapshot, true) };
+  }
+
+  publish();
+}
+
+//==============================================================================
+void SnapshotMorph::prepare (int numChannels, double newSampleRate)
+{
+  states.assign ((size_t) numChannels, {});
+
+  {
+    const juce::ScopedLock sl (designLock);
+    sampleRate = newSampleRate;
+    publish();
+  }
+
+  published.pull();
+  takeTable();
+}
+
+void SnapshotMorph::reset() noexcept
+{
+  for (auto& state : states)
+    state.fill ({});
+}
+
+bool SnapshotMorph::update() noexcept
+{
+  if (published.pull())
+    takeTable();
+
+  return getTable().numPoints >= 2;
+}
+
+void SnapshotMorph::design (const SnapshotSet& set, double rate, MorphTable& table)
+{
+  auto& numPoints = table.numPoints;
+  auto& points = table.points;
+  auto& usedSlots = table.usedSlots;
+  auto& numUsed = table.numUsed;
+
+  std::array<int, maxSnapshots> order {};
+  numPoints = 0;
+  table.lowestCutHz = 0;
+
+  for (int index = 0; index < maxSnapshots; ++index)
+    if (set.stored[(size_t) index])
+      order[(size_t) numPoints++] = index;
+
+  std::array<std::array<bool, numSlots>, 2> used {};
+
+  for (size_t side = 0; side < 2; ++side)
+  {
+    std::array<std::array<bool, numSlots>, maxSnapshots> active {};
+    FilterBank bank;
+
+    for (int point = 0; point < numPoints; ++point)
+    {
+      updateFilterBank (bank, set.settings[(size_t) order[(size_t) point]][side], rate);
+      table.lowestCutHz = point == 0 && side == 0 ? bank.lowestCutHz
+                                                  : juce::jmin (table.lowestCutHz, bank.lowestCutHz);
+
+      for (size_t slot = 0; slot < (size_t) numSlots; ++slot)
+      {
+        const auto& biquad = bank.coefficients[slot];
+        active[(size_t) point][slot] = bank.active[slot];
+
+        if (! bank.active[slot])
+          continue;
+
+        const auto svf = SvfCoefficients::fromBiquad (biquad);
+        points[side][(size_t) point][slot] = { (float) std::log (svf.g), (float) svf.k,
+                                               (float) svf.m0, (float) svf.m1, (float) svf.m2 };
+        used[side][slot] = used[side][slot] || ! biquad.isIdentity();
+      }
+    }
+
+    numUsed[side] = 0;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+      if (! used[side][(size_t) slot])
+        continue;
+
+      usedSlots[side][(size_t) numUsed[side]++] = slot;
+
+      // Where the slot is off, it passes the signal with the tuning of the
+      // nearest snapshot that has it on, so only its mix moves.
+      for (int point = 0; point < numPoints; ++point)
+      {
+        if (active[(size_t) point][(size_t) slot])
+          continue;
+
+        for (int distance = 1; distance < numPoints; ++distance)
+        {
+          const auto nearest = point - distance >= 0 && active[(size_t) (point - distance)][(size_t) slot]
+                                 ? point - distance : point + distance;
+
+          if (nearest < numPoints && active[(size_t) nearest][(size_t) slot])
+          {
+            const auto& tuning = points[side][(size_t) nearest][(size_t) slot];
+            points[side][(size_t) point][(size_t) slot] = { tuning.logG, tuning.k, 1.f, tuning.k, 1.f };
+            break;
+          }
+        }
+      }
+    }
+  }
+}
+
+void SnapshotMorph::takeTable() noexcept
+{
+  const auto& table = getTable();
+  std::array<std::array<bool, numSlots>, 2> used {};
+
+  for (size_t side = 0; side < 2; ++side)
+    for (int i = 0; i < table.numUsed[side]; ++i)
+      used[side][(size_t) table.usedSlots[side][(size_t) i]] = true;
+
+  // Sections that stopped being used start from silence when they come back.
+  // The second channel runs the right side in dual mono and the left otherwise.
+  for (size_t channel = 0; channel < states.size(); ++channel)
+    for (size_t slot = 0; slot < (size_t) numSlots; ++slot)
+      if (! used[0][slot] && (channel != 1 || ! used[1][slot]))
+        states[channel][slot] = {};
+
+  sectionPosition.fill (-1.f);
+}
+
+void SnapshotMorph::interpolate (int side, float position) noexcept
+{
+  const auto& table = getTable();
+  const auto numPoints = table.numPoints;
+  const auto scaled = position * (float) (numPoints - 1);
+  const auto from = juce::jmin ((int) scaled, numPoints - 2);
+  const auto t = scaled - (float) from;
+
+  for (int i = 0; i < table.numUsed[(size_t) side]; ++i)
+  {
+    const auto slot = (size_t) table.usedSlots[(size_t) side][(size_t) i];
+    const auto& p = table.points[(size_t) side][(size_t) from][slot];
+    const auto& q = table.points[(size_t) side][(size_t) from + 1][slot];
+
+    const auto g = std::exp (p.logG + t * (q.logG - p.logG));
+    const auto k = p.k + t * (q.k - p.k);
+    const auto m0 = p.m0 + t * (q.m0 - p.m0);
+
+    auto& section = sections[(size_t) side][slot];
+    section.a1 = 1.f / (1.f + g * (g + k));
+    section.a2 = g * section.a1;
+    section.a3 = g * section.a2;
+    section.c0 = m0;
+    section.c1 = p.m1 + t * (q.m1 - p.m1) - m0 * k;
+    section.c2 = p.m2 + t * (q.m2 - p.m2) - m0;
+  }
+
+  sectionPosition[(size_t) side] = position;
+}
+
+void SnapshotMorph::processChannel (int side, ChannelState& state, float* samples, size_t numSamples) noexcept
+{
+  const auto& table = getTable();
+
+  for (int i = 0; i < table.numUsed[(size_t) side]; ++i)
+  {
+    const auto slot = (size_t) table.usedSlots[(size_t) side][(size_t) i];
+    const auto s = sections[(size_t) side][slot];
+    auto ic1 = state[slot].ic1, ic2 = state[slot].ic2;
+
+    for (size_t n = 0; n < numSamples; ++n)
+    {
+      const auto v0 = samples[n];
+      const auto v3 = v0 - ic2;
+      const auto v1 = s.a1 * ic1 + s.a2 * v3;
+      const auto v2 = ic2 + s.a2 * ic1 + s.a3 * v3;
+      ic1 = 2.f * v1 - ic1;
+      ic2 = 2.f * v2 - ic2;
+      samples[n] = s.c0 * v0 + s.c1 * v1 + s.c2 * v2;
+    }
+
+    state[slot] = { ic1, ic2 };
+  }
+}
+
+void SnapshotMorph::processChannelPair (ChannelState& leftState, ChannelState& rightState,
+                                        float* left, float* right, size_t numSamples) noexcept
+{
+  // Two channels through the same section in one loop: each recursion is a
+  // chain of dependent multiplies, and the other channel's fills the gaps.
+  const auto& table = getTable();
+
+  for (int i = 0; i < table.numUsed[0]; ++i)
+  {
+    const auto slot = (size_t) table.usedSlots[0][(size_t) i];
+    const auto s = sections[0][slot];
+    auto lc1 = leftState[slot].ic1, lc2 = leftState[slot].ic2;
+    auto rc1 = rightState[slot].ic1, rc2 = rightState[slot].ic2;
+
+    for (size_t n = 0; n < numSamples; ++n)
+    {
+      const auto l0 = left[n], r0 = right[n];
+      const auto l3 = l0 - lc2, r3 = r0 - rc2;
+      const auto l1 = s.a1 * lc1 + s.a2 * l3, r1 = s.a1 * rc1 + s.a2 * r3;
+      const auto l2 = lc2 + s.a2 * lc1 + s.a3 * l3, r2 = rc2 + s.a2 * rc1 + s.a3 * r3;
+      lc1 = 2.f * l1 - lc1;
+      rc1 = 2.f * r1 - rc1;
+      lc2 = 2.f * l2 - lc2;
+      rc2 = 2.f * r2 - rc2;
+      left[n] = s.c0 * l0 + s.c1 * l1 + s.c2 * l2;
+      right[n] = s.c0 * r0 + s.c1 * r1 + s.c2 * r2;
+    }
+
+    leftState[slot] = { lc1, lc2 };
+    rightState[slot] = { rc1, rc2 };
+  }
+}
+
+void SnapshotMorph::process (const juce::dsp::AudioBlock<float>& block, bool dualMono,
+                             float morphStart, float morphEnd) noexcept
+{
+  jassert (getTable().numPoints >= 2);
+
+  const auto numChannels = juce::jmin (block.getNumChannels(), states.size());
+  const auto numSamples = block.getNumSamples();
+  const auto numSides = dualMono && numChannels == 2 ? 2 : 1;
+
+  // The second channel goes on from the state of the side it ran; only the
+  // sections that side did not use start from silence.
+  if ((numSides == 2) != processedDualMono)
+  {
+    if (states.size() > 1)
+    {
+      const auto& table = getTable();
+      const auto previousSide = processedDualMono ? 1 : 0;
+      std::array<bool, numSlots> ran {};
+
+      for (int i = 0; i < table.numUsed[(size_t) previousSide]; ++i)
+        ran[(size_t) table.usedSlots[(size_t) previousSide][(size_t) i]] = true;
+
+      for (size_t slot = 0; slot < (size_t) numSlots; ++slot)
+        if (! ran[slot])
+          states[1][slot] = {};
+    }
+
+    processedDualMono = numSides == 2;
+  }
+
+  for (size_t start = 0; start < numSamples; start += (size_t) controlInterval)
+  {
+    const auto length = juce::jmin ((size_t) controlInterval, numSamples - start);
+
+    // Each interval runs the position at its centre.
+    const auto centre = ((float) start + 0.5f * (float) length) / (float) numSamples;
+    const auto position = juce::jlimit (0.f, 1.f, morphStart + (morphEnd - morphStart) * centre);
+
+    for (int side = 0; side < numSides; ++side)
+      if (position != sectionPosition[(size_t) side])
+        interpolate (side, position);
+
+    if (numSides == 2)
+    {
+      processChannel (0, states[0], block.getChannelPointer (0) + start, length);
+      processChannel (1, states[1], block.getChannelPointer (1) + start, length);
+      continue;
+    }
+
+    size_t channel = 0;
+
+    for (; channel + 1 < numChannels; channel += 2)
+      processChannelPair (states[channel], states[channel + 1], block.getChannelPointer (channel) + start,
+                          block.getChannelPointer (channel + 1) + start, length);
+
+    if (channel < numChannels)
+      processChannel (0, states[channel], block.getChannelPointer (channel) + start, length);
+  }
+}
@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    SnapshotMorph.h
+    Up to four stored settings of the EQ and a morph between them, run as
+    state variable filters whose gains are interpolated per control interval.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "TripleBuffer.h"
+
+/** A section as a trapezoidal state variable filter: g = tan (pi f / fs), the
+    damping k = 1 / Q and the mix of the high, band and low pass outputs. Any
+    g > 0 and k > 0 is stable, and so is every point on a line between two such
+    sections, which is what lets the morph interpolate them where the direct
+    form's coefficients would go unstable in between.
+*/
+struct SvfCoefficients
+{
+  double g = 1, k = 2, m0 = 1, m1 = 2, m2 = 1;
+
+  /** The same transfer function as a stable biquad. Poles that have rounded
+      onto z = 1 or z = -1 are pulled just inside.
+  */
+  static SvfCoefficients fromBiquad (const BiquadCoefficients& biquad) noexcept;
+};
+
+/** The message thread stores the settings of both sides into a snapshot
+    slot, designs every stored snapshot into the FilterBank sections and
+    converts them to SvfCoefficients, and hands the finished table to the
+    audio thread through a TripleBuffer; prepare() does the same for a new
+    rate. The audio thread only takes the table over.
+
+    The morph position runs from the first stored snapshot to the last, in
+    slot order. Between two neighbours, log g, k and the mix are interpolated
+    linearly, so a centre frequency moves in octaves. A section that only
+    one side of the pair uses is an identity there, with the g and k of the
+    nearest snapshot that uses it, and is faded in by its mix alone.
+
+    The coefficients are recomputed every controlInterval samples while the
+    position moves and not at all while it rests, so sweeping the morph at
+    audio rate costs little more than holding it. Only the sections any
+    snapshot uses are run.
+*/
+class SnapshotMorph
+{
+public:
+  static constexpr int maxSnapshots = 4;
+  static constexpr int controlInterval = 64;
+
+  //==============================================================================
+  /** Message thread. */
+  void store (int index, const ChainSettings& left, const ChainSettings& right);
+  void clear (int index);
+  bool isStored (int index) const noexcept;
+
+  static const juce::Identifier stateType;
+
+  juce::ValueTree toValueTree() const;
+  void fromValueTree (const juce::ValueTree& tree);
+
+  //==============================================================================
+  /** Call before processing, from the thread that processes. Designs the
+      table again for the new rate.
+  */
+  void prepare (int numChannels, double newSampleRate);
+
+  /** Clears the state of every section. */
+  void reset() noexcept;
+
+  /** Audio thread: takes a newly designed table and returns true if at least
+      two snapshots are stored, which process() needs.
+  */
+  bool update() noexcept;
+
+  /** Audio thread: the lowest high or low pass cut-off of any stored
+      snapshot, which sets how long the sections take to settle.
+  */
+  float getLowestCutHz() const noexcept { return getTable().lowestCutHz; }
+
+  /** Audio thread: runs the block with the position moving linearly from
+      morphStart to morphEnd across it. In dual mono the second channel runs
+      the right side of each snapshot; otherwise every channel runs the left.
+      When that changes, the second channel carries its state over to the
+      other side's sections, as it would over a change of coefficients.
+  */
+  void process (const juce::dsp::AudioBlock<float>& block, bool dualMono,
+                float morphStart, float morphEnd) noexcept;
+
+private:
+  static constexpr int numSlots = FilterBank::numSlots;
+
+  struct SnapshotSet
+  {
+    std::array<bool, maxSnapshots> stored {};
+    std::array<std::array<ChainSettings, 2>, maxSnapshots> settings {};   // left, right
+  };
+
+  // The endpoints are interpolated in this form.
+  struct MorphPoint
+  {
+    float logG = 0, k = 2, m0 = 1, m1 = 2, m2 = 1;
+  };
+
+  // The stored snapshots in slot order, per side, and the slots any of them uses.
+  struct MorphTable
+  {
+    int numPoints = 0;
+    std::array<std::array<std::array<MorphPoint, numSlots>, maxSnapshots>, 2> points {};
+    std::array<std::array<int, numSlots>, 2> usedSlots {};
+    std::array<int, 2> numUsed {};
+    float lowestCutHz = 0;
+  };
+
+  // What the recursion runs per sample, with the mix in the basis of its own
+  // intermediate values: y = c0 x + c1 v1 + c2 v2.
+  struct Section
+  {
+    float a1 = 0, a2 = 0, a3 = 0, c0 = 1, c1 = 0, c2 = 0;
+  };
+
+  struct SectionState
+  {
+    float ic1 = 0, ic2 = 0;
+  };
+
+  using ChannelState = std::array<SectionState, numSlots>;
+
+  /** Designs the snapshots into the next table and publishes it; call with
+      designLock held.
+  */
+  void publish();
+  static void design (const SnapshotSet& set, double rate, MorphTable& table);
+  void takeTable() noexcept;
+  void interpolate (int side, float position) noexcept;
+  void processChannel (int side, ChannelState& state, float* samples, size_t numSamples) noexcept;
+  void processChannelPair (ChannelState& leftState, ChannelState& rightState, float* left, float* right,
+                           size_t numSamples) noexcept;
+
+  const MorphTable& getTable() const noexcept { return published.getReadBuffer(); }
+
+  // Message thread, and prepare(), which may run on another.
+  juce::CriticalSection designLock;
+  SnapshotSet snapshots;
+  double sampleRate = 48000.0;
+  TripleBuffer<MorphTable> published;
+
+  // Audio thread.
+  std::array<std::array<Section, numSlots>, 2> sections {};
+  std::array<float, 2> sectionPosition { -1.f, -1.f };   // -1 until interpolated
+  std::vector<ChannelState> states;
+  bool processedDualMono = false;
+};
@@ -0,0 +1,250 @@
+/*
+  ==============================================================================
+
+    Trace.cpp
+    Opt-in timeline of scoped DSP and GUI events, written as a Chrome trace
+    JSON file that chrome://tracing and Perfetto can open.
+
+  ==============================================================================
+*/
+
+#include "Trace.h"
+
+namespace Trace
+{
+namespace
+{
+  struct Event
+  {
+    const char* name;
+    juce::int64 startTicks, endTicks;
+  };
+
+  /** Single producer (the owning thread), single consumer (the writer thread). */
+  struct ThreadBuffer
+  {
+    static constexpr juce::uint32 capacity = 8192;
+    static_assert ((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    bool push (const Event& event) noexcept
+    {
+      const auto write = writeIndex.load (std::memory_order_relaxed);
+
+      if (write - readIndex.load (std::memory_order_acquire) == capacity)
+        return false;
+
+      events[write & (capacity - 1)] = event;
+      writeIndex.store (write + 1, std::memory_order_release);
+      return true;
+    }
+
+    std::array<Event, capacity> events;
+    std::atomic<juce::uint32> writeIndex { 0 }, readIndex { 0 };
+    std::atomic<juce::uint32> dropped { 0 };
+
+    // Set by the claiming thread before it publishes the ring as claimed.
+    juce::String threadName;
+    bool isMessageThread = false;
+    std::atomic<bool> claimed { false };
+
+    // Writer thread only.
+    bool nameWritten = false;
+  };
+
+  constexpr int maxThreads = 32;
+
+  std::atomic<Writer*> activeWriter { nullptr };
+  std::atomic<juce::uint32> writerGeneration { 0 };
+
+  // Calls of record() between loading activeWriter and their last use of it;
+  // the writer is only destroyed once this has drained.
+  std::atomic<int> recordsInFlight { 0 };
+
+  thread_local ThreadBuffer* cachedBuffer = nullptr;
+  thread_local juce::uint32 cachedGeneration = 0;
+}
+
+//==============================================================================
+class Writer : private juce::Thread
+{
+public:
+  explicit Writer (const juce::File& file)
+    : juce::Thread ("EQ5b trace writer"),
+      generation (++writerGeneration),
+      startTicks (juce::Time::getHighResolutionTicks()),
+      stream (file)
+  {
+    if (stream.failedToOpen())
+      return;
+
+    stream.setPosition (0);
+    stream.truncate();
+    stream << "[\n";
+
+    DBG ("EQ5b trace: writing " << file.getFullPathName());
+    activeWriter.store (this, std::memory_order_release);
+    startThread (juce::Thread::Priority::low);
+  }
+
+  ~Writer() override
+  {
+    // Both sequentially consistent with record(): once the pointer is gone,
+    // any call still using it has counted itself in.
+    activeWriter.store (nullptr);
+
+    while (recordsInFlight.load() > 0)
+      juce::Thread::yield();
+
+    stopThread (1000);
+
+    if (! stream.failedToOpen())
+    {
+      flush();
+      stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"EQ5b\"}}]\n";
+    }
+  }
+
+  /** nullptr once every ring has been claimed by another thread. */
+  ThreadBuffer* getBufferForThisThread() noexcept
+  {
+    if (cachedGeneration != generation)
+    {
+      const auto index = nextBuffer.fetch_add (1, std::memory_order_relaxed);
+      ThreadBuffer* buffer = nullptr;
+
+      if (index < maxThreads)
+      {
+        // Copying a thread's name only shares its text.
+        buffer = &buffers[(size_t) index];
+
+        if (auto* thread = juce::Thread::getCurrentThread())
+          buffer->threadName = thread->getThreadName();
+
+        buffer->isMessageThread = juce::MessageManager::existsAndIsCurrentThread();
+        buffer->claimed.store (true, std::memory_order_release);
+      }
+      else
+      {
+        unrecordedThreads.fetch_add (1, std::memory_order_relaxed);
+      }
+
+      cachedBuffer = buffer;
+      cachedGeneration = generation;
+    }
+
+    return cachedBuffer;
+  }
+
+private:
+  void run() override
+  {
+    while (! threadShouldExit())
+    {
+      wait (100);
+      flush();
+    }
+  }
+
+  /** Only the writer thread, or the destructor once it has stopped, reads
+      the rings, and they live as long as the writer, so no lock is held.
+  */
+  void flush()
+  {
+    for (int index = 0; index < maxThreads; ++index)
+    {
+      auto* buffer = &buffers[(size_t) index];
+
+      if (! buffer->claimed.load (std::memory_order_acquire))
+        continue;
+
+      const auto threadIndex = index + 1;
+
+      if (! buffer->nameWritten)
+      {
+        const auto threadName = buffer->threadName.isNotEmpty() ? buffer->threadName
+                              : buffer->isMessageThread ? juce::String ("Message thread")
+                                                        : "Thread " + juce::String (threadIndex);
+
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadIndex
+               << ",\"args\":{\"name\":\"" << threadName << "\"}},\n";
+        buffer->nameWritten = true;
+      }
+
+      const auto write = buffer->writeIndex.load (std::memory_order_acquire);
+      auto read = buffer->readIndex.load (std::memory_order_relaxed);
+
+      for (; read != write; ++read)
+      {
+        const auto& event = buffer->events[read & (ThreadBuffer::capacity - 1)];
+        stream << "{\"name\":\"" << event.name << "\",\"cat\":\"EQ5b\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+               << threadIndex << ",\"ts\":" << juce::String (toMicroseconds (event.startTicks - startTicks), 3)
+               << ",\"dur\":" << juce::String (toMicroseconds (event.endTicks - event.startTicks), 3) << "},\n";
+      }
+
+      buffer->readIndex.store (read, std::memory_order_release);
+
+      if (const auto dropped = buffer->dropped.exchange (0))
+        DBG ("EQ5b trace: thread " << threadIndex << " dropped " << (int) dropped << " events");
+    }
+
+    if (const auto unrecorded = unrecordedThreads.exchange (0))
+      DBG ("EQ5b trace: " << (int) unrecorded << " more threads than rings were not recorded");
+
+    stream.flush();
+  }
+
+  static double toMicroseconds (juce::int64 ticks) noexcept
+  {
+    return 1.0e6 * juce::Time::highResolutionTicksToSeconds (ticks);
+  }
+
+  const juce::uint32 generation;
+  const juce::int64 startTicks;
+
+  juce::FileOutputStream stream;
+  std::unique_ptr<ThreadBuffer[]> buffers { new ThreadBuffer[maxThreads] };
+  std::atomic<int> nextBuffer { 0 };
+  std::atomic<int> unrecordedThreads { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE (Writer)
+};
+
+//==============================================================================
+Session::Session()
+{
+ #if EQ5B_TRACING
+  const auto setting = juce::SystemStats::getEnvironmentVariable ("EQ5B_TRACE", {});
+
+  if (setting.isEmpty())
+    return;
+
+  const auto file = juce::File::isAbsolutePath (setting)
+                      ? juce::File (setting)
+                      : juce::File::getSpecialLocation (juce::File::tempDirectory)
+                          .getChildFile ("EQ5b-trace-" + juce::Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S") + ".json");
+
+  writer = std::make_unique<Writer> (file);
+ #endif
+}
+
+Session::~Session() = default;
+
+bool isRecording() noexcept
+{
+  return activeWriter.load (std::memory_order_relaxed) != nullptr;
+}
+
+void record (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+  recordsInFlight.fetch_add (1);
+
+  if (auto* writer = activeWriter.load())
+  {
+    if (auto* buffer = writer->getBufferForThisThread())
+      if (! buffer->push ({ name, startTicks, endTicks }))
+        buffer->dropped.fetch_add (1, std::memory_order_relaxed);
+  }
+
+  recordsInFlight.fetch_sub (1, std::memory_order_release);
+}
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Trace.h
+    Opt-in timeline of scoped DSP and GUI events, written as a Chrome trace
+    JSON file that chrome://tracing and Perfetto can open.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Builds without EQ5B_TRACING=0 compile the scopes in; they only record while
+    a Trace::Session is writing, and otherwise cost one atomic load each.
+*/
+#ifndef EQ5B_TRACING
+ #define EQ5B_TRACING 1
+#endif
+
+namespace Trace
+{
+  class Writer;
+
+  /** Held by every plugin instance through a SharedResourcePointer. If the
+      environment variable EQ5B_TRACE is set when the first instance is created,
+      events are recorded until the last instance goes away. The variable names
+      the output file; any value that is not an absolute path writes
+      EQ5b-trace-<time>.json to the temporary directory instead.
+
+      The writer allocates maxThreads lock-free rings up front, and each thread
+      claims one with an atomic increment at its first event, so recording
+      never allocates or locks; threads beyond maxThreads are not recorded. A
+      background thread drains the rings into the file every 100 ms; events
+      that find their ring full are dropped and counted.
+  */
+  class Session
+  {
+  public:
+    Session();
+    ~Session();
+
+  private:
+    std::unique_ptr<Writer> writer;
+
+    JUCE_DECLARE_NON_COPYABLE (Session)
+  };
+
+  bool isRecording() noexcept;
+
+  /** name must outlive the session; pass a string literal. */
+  void record (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+  /** Records the time between its construction and destruction. */
+  class Scope
+  {
+  public:
+    explicit Scope (const char* eventName) noexcept
+      : name (eventName), startTicks (isRecording() ? juce::Time::getHighResolutionTicks() : 0)
+    {
+    }
+
+    ~Scope() noexcept
+    {
+      if (startTicks != 0)
+        record (name, startTicks, juce::Time::getHighResolutionTicks());
+    }
+
+  private:
+    const char* name;
+    juce::int64 startTicks;
+
+    JUCE_DECLARE_NON_COPYABLE (Scope)
+  };
+}
+
+#if EQ5B_TRACING
+ #define EQ5B_TRACE_SCOPE(name) const Trace::Scope JUCE_JOIN_MACRO (traceScope_, __LINE__) (name)
+#else
+ #define EQ5B_TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    Wait-free hand-over of the latest value from one writer thread to one
+    reader thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+/** The writer fills getWriteBuffer() and calls publish(); the reader calls
+    pull() and, if it returns true, reads getReadBuffer(). Neither side ever
+    blocks or allocates; intermediate values may be skipped.
+*/
+template <typename ValueType>
+class TripleBuffer
+{
+public:
+  ValueType& getWriteBuffer() noexcept { return slots[(size_t) back]; }
+
+  void publish() noexcept
+  {
+    back = middle.exchange (back | dirtyFlag, std::memory_order_acq_rel) & indexMask;
+  }
+
+  bool pull() noexcept
+  {
+    if ((middle.load (std::memory_order_acquire) & dirtyFlag) == 0)
+      return false;
+
+    front = middle.exchange (front, std::memory_order_acq_rel) & indexMask;
+    return true;
+  }
+
+  const ValueType& getReadBuffer() const noexcept { return slots[(size_t) front]; }
+
+private:
+  static constexpr int indexMask = 3, dirtyFlag = 4;
+
+  std::array<ValueType, 3> slots {};
+  std::atomic<int> middle { 1 };
+  int back = 0, front = 2;
+};
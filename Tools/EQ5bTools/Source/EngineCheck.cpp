@@ -0,0 +1,756 @@
+/*
+  ==============================================================================
+
+    EngineCheck.cpp
+    Null and response checks of the filter engine against a double precision
+    reference, juce::dsp's own filters and the golden files in Tests/golden.
+
+  ==============================================================================
+*/
+
+#include "EngineCheck.h"
+#include "PluginProcessor.h"
+#include "FilterCascade.h"
+#include "ButterworthDesign.h"
+#include "ChannelWorkerPool.h"
+#include <complex>
+#include <iostream>
+
+namespace EngineCheck
+{
+namespace
+{
+  using Complex = std::complex<double>;
+  using Sections = std::array<PreciseBiquadCoefficients, FilterCascade::numSlots>;
+  using JuceCoefficients = juce::dsp::IIR::Coefficients<double>;
+
+  constexpr int impulseLength = 32768;
+  constexpr int signalLength = 8192;
+  constexpr int numResponsePoints = 48;
+  constexpr int numPoolRuns = 20000;
+  constexpr int numDesignRuns = 100;
+
+  struct Case
+  {
+    juce::String name, goldenName;
+    ChainSettings settings;
+    double sampleRate;
+    FilterCascade::Form form;
+  };
+
+  //==============================================================================
+  std::vector<ChainSettings> makeSettingsGrid()
+  {
+    std::vector<ChainSettings> grid;
+
+    for (int slope = slope_12; slope <= slope_48; ++slope)
+    {
+      for (auto numBands : { 3, maxPeakBands })
+      {
+        ChainSettings settings;
+        settings.hpFilter.cutf = slope % 2 == 0 ? 30.f : 250.f;
+        settings.hpFilter.slope = static_cast<Slope> (slope);
+        settings.lpFilter.cutf = slope % 2 == 0 ? 18000.f : 4000.f;
+        settings.lpFilter.slope = static_cast<Slope> (slope_48 - slope);
+        settings.numBands = numBands;
+
+        for (int band = 0; band < numBands; ++band)
+        {
+          auto& peak = settings.peaks[(size_t) band];
+          peak.freq = juce::mapToLog10 ((band + 0.5f) / (float) numBands, 40.f, 16000.f);
+          peak.gain = band % 2 == 0 ? 6.f : -9.f;
+          peak.q = numBands > 3 ? 2.f : 0.7f;
+        }
+
+        grid.push_back (settings);
+      }
+    }
+
+    return grid;
+  }
+
+  std::vector<Case> makeCases()
+  {
+    std::vector<Case> cases;
+    const auto grid = makeSettingsGrid();
+
+    for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 176400.0, 192000.0 })
+      for (auto design : { design_bilinear, design_matched })
+        for (auto form : { FilterCascade::Form::cascade, FilterCascade::Form::parallel })
+          for (size_t i = 0; i < grid.size(); ++i)
+          {
+            auto settings = grid[i];
+            settings.hpFilter.design = settings.lpFilter.design = design;
+
+            for (auto& peak : settings.peaks)
+              peak.design = design;
+
+            const auto prefix = juce::String ((int) sampleRate) + "-"
+                              + (design == design_matched ? "matched" : "bilinear") + "-";
+            const auto name = prefix + (form == FilterCascade::Form::parallel ? "parallel" : "cascade") + "-"
+                            + juce::String ((int) i);
+
+            // Both forms of a setting are held to the same file.
+            cases.push_back ({ name, prefix + juce::String ((int) i), settings, sampleRate, form });
+          }
+
+    return cases;
+  }
+
+  //==============================================================================
+  std::vector<float> makeImpulse()
+  {
+    std::vector<float> signal ((size_t) impulseLength, 0.f);
+    signal[0] = 1.f;
+    return signal;
+  }
+
+  std::vector<float> makeSweep (double sampleRate)
+  {
+    // Exponential sine sweep from 20 Hz to just below Nyquist.
+    std::vector<float> signal ((size_t) signalLength);
+    const auto f0 = 20.0, f1 = 0.45 * sampleRate;
+    const auto duration = signalLength / sampleRate;
+    const auto k = std::log (f1 / f0);
+
+    for (int i = 0; i < signalLength; ++i)
+    {
+      const auto t = i / sampleRate;
+      const auto phase = juce::MathConstants<double>::twoPi * f0 * duration / k * (std::exp (t / duration * k) - 1.0);
+      signal[(size_t) i] = (float) (0.5 * std::sin (phase));
+    }
+
+    return signal;
+  }
+
+  std::vector<float> makeNoise()
+  {
+    std::vector<float> signal ((size_t) signalLength);
+    juce::Random random (0x45513562);
+
+    for (auto& sample : signal)
+      sample = 0.5f * (2.f * random.nextFloat() - 1.f);
+
+    return signal;
+  }
+
+  /** The sections the cascade runs, as the designers computed them in double
+      precision rather than rounded to float.
+  */
+  int getExactSections (const FilterBank& bank, Sections& sections)
+  {
+    auto numSections = 0;
+
+    for (size_t slot = 0; slot < (size_t) FilterBank::numSlots; ++slot)
+      if (bank.active[slot] && ! bank.coefficients[slot].isIdentity())
+        sections[(size_t) numSections++] = bank.preciseCoefficients[slot];
+
+    return numSections;
+  }
+
+  //==============================================================================
+  std::vector<double> renderReference (const Sections& sections, int numSections, const std::vector<float>& input)
+  {
+    std::vector<double> output (input.begin(), input.end());
+
+    for (int s = 0; s < numSections; ++s)
+    {
+      const auto& c = sections[(size_t) s];
+      double s1 = 0, s2 = 0;
+
+      for (auto& x : output)
+      {
+        const auto y = c.b0 * x + s1;
+        s1 = c.b1 * x - c.a1 * y + s2;
+        s2 = c.b2 * x - c.a2 * y;
+        x = y;
+      }
+    }
+
+    return output;
+  }
+
+  /** Null depth in dB of the engine against the reference, relative to the reference peak. */
+  double getNullDb (const std::vector<float>& engine, const std::vector<double>& reference)
+  {
+    double peak = 1.0e-20, residual = 0.0;
+
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+      peak = juce::jmax (peak, std::abs (reference[i]));
+      residual = juce::jmax (residual, std::abs (engine[i] - reference[i]));
+    }
+
+    return 20.0 * std::log10 (juce::jmax (residual, 1.0e-20) / peak);
+  }
+
+  Complex analyticResponse (const PreciseBiquadCoefficients* sections, int numSections, double omega)
+  {
+    const auto w = std::polar (1.0, -omega);
+    Complex h { 1.0, 0.0 };
+
+    for (int s = 0; s < numSections; ++s)
+    {
+      const auto& c = sections[s];
+      h *= (c.b0 + w * (c.b1 + w * c.b2)) / (1.0 + w * (c.a1 + w * c.a2));
+    }
+
+    return h;
+  }
+
+  double getResponseFrequency (int index, double sampleRate)
+  {
+    return juce::mapToLog10 ((index + 0.5) / numResponsePoints, 20.0, 0.48 * sampleRate);
+  }
+
+  /** The same filter designed by juce::dsp alone, sharing no code with the
+      designers: the RBJ peaks of IIR::Coefficients and the Butterworth cuts
+      of FilterDesign. Only the bilinear design has such a counterpart.
+  */
+  juce::ReferenceCountedArray<JuceCoefficients> designWithJuce (const ChainSettings& settings, double sampleRate)
+  {
+    using Design = juce::dsp::FilterDesign<double>;
+
+    auto sections = Design::designIIRHighpassHighOrderButterworthMethod (settings.hpFilter.cutf, sampleRate,
+                                                                         2 * (settings.hpFilter.slope + 1));
+
+    for (int band = 0; band < settings.numBands; ++band)
+    {
+      const auto& peak = settings.peaks[(size_t) band];
+      sections.add (JuceCoefficients::makePeakFilter (sampleRate, peak.freq, peak.q,
+                                                      juce::Decibels::decibelsToGain ((double) peak.gain)));
+    }
+
+    sections.addArray (Design::designIIRLowpassHighOrderButterworthMethod (settings.lpFilter.cutf, sampleRate,
+                                                                          2 * (settings.lpFilter.slope + 1)));
+    return sections;
+  }
+
+  Complex juceResponse (const juce::ReferenceCountedArray<JuceCoefficients>& sections, double omega)
+  {
+    const auto w = std::polar (1.0, -omega);
+    Complex h { 1.0, 0.0 };
+
+    // Coefficients holds b0 ... bN, a1 ... aN, normalised to a0 = 1.
+    for (const auto* section : sections)
+    {
+      const auto order = section->getFilterOrder();
+      const auto* raw = section->getRawCoefficients();
+      Complex num { raw[0], 0.0 }, den { 1.0, 0.0 }, power { 1.0, 0.0 };
+
+      for (size_t i = 1; i <= order; ++i)
+      {
+        power *= w;
+        num += raw[i] * power;
+        den += raw[order + i] * power;
+      }
+
+      h *= num / den;
+    }
+
+    return h;
+  }
+
+  Complex measuredResponse (const std::vector<float>& impulseResponse, double omega)
+  {
+    Complex h { 0.0, 0.0 };
+    const auto step = std::polar (1.0, -omega);
+    Complex rotation { 1.0, 0.0 };
+
+    for (auto sample : impulseResponse)
+    {
+      h += (double) sample * rotation;
+      rotation *= step;
+    }
+
+    return h;
+  }
+
+  //==============================================================================
+  void render (FilterCascade& cascade, std::vector<float>& signal)
+  {
+    cascade.reset();
+
+    for (size_t start = 0; start < signal.size(); start += 512)
+    {
+      float* channels[] = { signal.data() + start };
+      juce::dsp::AudioBlock<float> block (channels, 1, juce::jmin ((size_t) 512, signal.size() - start));
+      cascade.process (juce::dsp::ProcessContextReplacing<float> (block));
+    }
+  }
+
+  /** Feeds silence until the background designer has delivered the parallel form. */
+  bool waitForParallelForm (FilterCascade& cascade)
+  {
+    for (int attempt = 0; attempt < 2000; ++attempt)
+    {
+      float silence = 0.f;
+      float* channels[] = { &silence };
+      juce::dsp::AudioBlock<float> block (channels, 1, 1);
+      cascade.process (juce::dsp::ProcessContextReplacing<float> (block));
+
+      if (cascade.isUsingParallelForm())
+        return true;
+
+      juce::Thread::sleep (1);
+    }
+
+    return false;
+  }
+
+  /** Tests/golden in the closest parent of the executable, or failing that
+      of the working directory, that has one.
+  */
+  juce::File findGoldenDirectory()
+  {
+    for (const auto& start : { juce::File::getSpecialLocation (juce::File::currentExecutableFile),
+                               juce::File::getCurrentWorkingDirectory() })
+    {
+      for (auto directory = start.getParentDirectory();; directory = directory.getParentDirectory())
+      {
+        const auto golden = directory.getChildFile ("Tests").getChildFile ("golden");
+
+        if (golden.isDirectory())
+          return golden;
+
+        if (directory.isRoot())
+          break;
+      }
+    }
+
+    return {};
+  }
+
+  /** One line per response frequency: Hz, magnitude in dB and phase in degrees. */
+  bool writeGolden (const juce::File& file, const Case& testCase, const std::vector<Complex>& response)
+  {
+    juce::String text;
+    text << "# EQ5b engine check golden response " << testCase.goldenName << juce::newLine
+         << "# frequency (Hz), magnitude (dB), phase (degrees) of the cascade form's impulse response"
+         << juce::newLine;
+
+    for (int i = 0; i < numResponsePoints; ++i)
+    {
+      const auto& h = response[(size_t) i];
+      text << juce::String (getResponseFrequency (i, testCase.sampleRate), 3) << " "
+           << juce::String (juce::Decibels::gainToDecibels (std::abs (h), -400.0), 6) << " "
+           << juce::String (juce::radiansToDegrees (std::arg (h)), 4) << juce::newLine;
+    }
+
+    return file.replaceWithText (text);
+  }
+
+  /** Forks numPoolRuns runs over a pool of its own, cycling through every
+      group count so that a worker left over from a wide run meets a narrower
+      one. Each group busy-waits a length that varies with the run and the
+      group, then counts itself; when run() returns, every group below the
+      count must have run exactly once and none above it at all.
+  */
+  void checkChannelWorkerPool (Result& result)
+  {
+    ChannelWorkerPool pool;
+    const auto maxGroups = pool.getMaxGroups();
+
+    ++result.numCases;
+
+    if (maxGroups < 2)
+      return;
+
+    std::array<std::atomic<int>, 64> executions;
+    int failedRuns = 0;
+
+    for (int runIndex = 0; runIndex < numPoolRuns; ++runIndex)
+    {
+      const auto numGroups = 2 + runIndex % (maxGroups - 1);
+
+      for (auto& count : executions)
+        count.store (0, std::memory_order_relaxed);
+
+      auto task = [&executions, runIndex] (int group)
+      {
+        // A late group still writing after run() returned is what this catches.
+        auto spins = (runIndex * 7 + group * 13) % 200;
+        for (volatile int i = 0; i < spins; ++i) {}
+
+        executions[(size_t) group].fetch_add (1, std::memory_order_relaxed);
+      };
+
+      if (! pool.run (numGroups, task))
+      {
+        result.failures.add ("channel workers: run " + juce::String (runIndex) + " was refused while idle");
+        return;
+      }
+
+      for (int group = 0; group < (int) executions.size(); ++group)
+      {
+        const auto count = executions[(size_t) group].load (std::memory_order_relaxed);
+
+        if (count != (group < numGroups ? 1 : 0) && failedRuns++ < 5)
+          result.failures.add ("channel workers: run " + juce::String (runIndex) + " of " + juce::String (numGroups)
+                               + " groups ran group " + juce::String (group) + " " + juce::String (count) + " times");
+      }
+    }
+  }
+
+  /** Designs every order of both cuts with designButterworth and compares
+      the magnitude with FilterDesign<double>; both are in double precision,
+      up to 192 kHz where the lowest cuts are most sensitive. The timing then designs the same grid numDesignRuns times with
+      designButterworth and with FilterDesign<float>, which the cuts used
+      before; that one allocates every section it returns.
+  */
+  void checkButterworth (const Limits& limits, Result& result)
+  {
+    struct Cut
+    {
+      double sampleRate, frequency;
+      int order;
+      bool highPass;
+    };
+
+    std::vector<Cut> cuts;
+
+    for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 176400.0, 192000.0 })
+      for (auto frequency : { 20.0, 30.0, 100.0, 1000.0, 10000.0, 18000.0 })
+        for (int order = 1; order <= maxButterworthOrder; ++order)
+          for (auto highPass : { false, true })
+            cuts.push_back ({ sampleRate, frequency, order, highPass });
+
+    for (const auto& cut : cuts)
+    {
+      ++result.numCases;
+
+      const auto name = juce::String ("butterworth ") + (cut.highPass ? "high-pass " : "low-pass ")
+                      + juce::String (cut.order) + " at " + juce::String (cut.frequency) + " Hz, "
+                      + juce::String ((int) cut.sampleRate);
+
+      std::array<PreciseBiquadCoefficients, maxButterworthSections> sections;
+      const auto numSections = designButterworth (cut.sampleRate, cut.frequency, cut.order, cut.highPass,
+                                                  sections.data());
+
+      using Reference = juce::dsp::FilterDesign<double>;
+      const auto reference = cut.highPass
+                           ? Reference::designIIRHighpassHighOrderButterworthMethod (cut.frequency, cut.sampleRate, cut.order)
+                           : Reference::designIIRLowpassHighOrderButterworthMethod (cut.frequency, cut.sampleRate, cut.order);
+
+      if (reference.size() != numSections)
+      {
+        result.failures.add (name + ": " + juce::String (numSections) + " sections, FilterDesign has "
+                             + juce::String (reference.size()));
+        continue;
+      }
+
+      for (int i = 0; i < numResponsePoints; ++i)
+      {
+        const auto freq = getResponseFrequency (i, cut.sampleRate);
+        const auto omega = juce::MathConstants<double>::twoPi * freq / cut.sampleRate;
+
+        auto expected = 1.0;
+
+        for (const auto* section : reference)
+          expected *= section->getMagnitudeForFrequency (freq, cut.sampleRate);
+
+        if (juce::Decibels::gainToDecibels (expected, -400.0) < limits.responseFloorDb)
+          continue;
+
+        const auto measured = std::abs (analyticResponse (sections.data(), numSections, omega));
+        const auto error = std::abs (juce::Decibels::gainToDecibels (measured / expected, -400.0));
+        result.worstButterworthDb = juce::jmax (result.worstButterworthDb, error);
+
+        if (error > limits.butterworthDb)
+        {
+          result.failures.add (name + ": magnitude at " + juce::String (freq, 1) + " Hz is off by "
+                               + juce::String (error, 4) + " dB");
+          break;
+        }
+      }
+    }
+
+    // Summed into a volatile so that neither designer is optimised away.
+    volatile float sink = 0.f;
+    const auto numDesigns = (double) (numDesignRuns * cuts.size());
+
+    auto start = juce::Time::getHighResolutionTicks();
+
+    for (int repetition = 0; repetition < numDesignRuns; ++repetition)
+      for (const auto& cut : cuts)
+      {
+        std::array<PreciseBiquadCoefficients, maxButterworthSections> sections;
+        designButterworth (cut.sampleRate, cut.frequency, cut.order, cut.highPass, sections.data());
+        sink = sink + (float) sections[0].b0;
+      }
+
+    result.butterworthMicroseconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start)
+                                   * 1.0e6 / numDesigns;
+
+    start = juce::Time::getHighResolutionTicks();
+
+    for (int repetition = 0; repetition < numDesignRuns; ++repetition)
+      for (const auto& cut : cuts)
+      {
+        using Design = juce::dsp::FilterDesign<float>;
+        const auto designed = cut.highPass
+                            ? Design::designIIRHighpassHighOrderButterworthMethod ((float) cut.frequency, cut.sampleRate, cut.order)
+                            : Design::designIIRLowpassHighOrderButterworthMethod ((float) cut.frequency, cut.sampleRate, cut.order);
+        sink = sink + designed.getFirst()->coefficients[0];
+      }
+
+    result.filterDesignMicroseconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start)
+                                    * 1.0e6 / numDesigns;
+  }
+
+  /** Returns an empty string if the measured response matches the file
+      within the limits wherever the file is above responseFloorDb,
+      otherwise what was wrong.
+  */
+  juce::String compareWithGolden (const juce::File& file, const Case& testCase, const std::vector<Complex>& response,
+                                  const Limits& limits, Result& result)
+  {
+    if (! file.existsAsFile())
+      return "missing " + file.getFullPathName() + " (--update-golden creates it)";
+
+    juce::StringArray lines;
+    file.readLines (lines);
+    auto point = 0;
+
+    for (const auto& line : lines)
+    {
+      if (line.trim().isEmpty() || line.startsWithChar ('#'))
+        continue;
+
+      const auto values = juce::StringArray::fromTokens (line, false);
+
+      if (values.size() != 3 || point >= numResponsePoints)
+        return "cannot read " + file.getFileName() + " as " + juce::String (numResponsePoints) + " response points";
+
+      const auto hz = values[0].getDoubleValue();
+      const auto goldenDb = values[1].getDoubleValue();
+      const auto goldenDegrees = values[2].getDoubleValue();
+      const auto& h = response[(size_t) point];
+
+      if (std::abs (hz - getResponseFrequency (point++, testCase.sampleRate)) > 1.0e-3 * hz)
+        return file.getFileName() + " holds other frequencies";
+
+      if (goldenDb < limits.responseFloorDb)
+        continue;
+
+      const auto magnitudeError = std::abs (juce::Decibels::gainToDecibels (std::abs (h), -400.0) - goldenDb);
+      const auto phaseError = std::abs (std::remainder (juce::radiansToDegrees (std::arg (h)) - goldenDegrees, 360.0));
+
+      result.worstGoldenDb = juce::jmax (result.worstGoldenDb, magnitudeError);
+      result.worstGoldenDegrees = juce::jmax (result.worstGoldenDegrees, phaseError);
+
+      if (magnitudeError > limits.goldenMagnitudeDb || phaseError > limits.goldenPhaseDegrees)
+        return "response at " + juce::String (hz, 1) + " Hz drifted from " + file.getFileName() + " by "
+             + juce::String (magnitudeError, 4) + " dB, " + juce::String (phaseError, 3) + " degrees";
+    }
+
+    if (point != numResponsePoints)
+      return "cannot read " + file.getFileName() + " as " + juce::String (numResponsePoints) + " response points";
+
+    return {};
+  }
+}
+
+//==============================================================================
+juce::String Result::getSummary() const
+{
+  juce::String summary;
+  summary << numCases << " cases, " << failures.size() << " failed; worst null "
+          << juce::String (worstCascadeNullDb, 1) << " dB (cascade), "
+          << juce::String (worstParallelNullDb, 1) << " dB (parallel); worst response error "
+          << juce::String (worstMagnitudeDb, 4) << " dB, "
+          << juce::String (worstPhaseDegrees, 3) << " degrees, from golden "
+          << juce::String (worstGoldenDb, 4) << " dB, "
+          << juce::String (worstGoldenDegrees, 3) << " degrees; Butterworth within "
+          << juce::String (worstButterworthDb, 4) << " dB of FilterDesign, designed in "
+          << juce::String (butterworthMicroseconds, 3) << " us against "
+          << juce::String (filterDesignMicroseconds, 3) << " us";
+
+  for (const auto& failure : failures)
+    summary << juce::newLine << "  " << failure;
+
+  return summary;
+}
+
+Result runChecks (const Options& options)
+{
+  const auto& limits = options.limits;
+  Result result;
+
+  if (! options.goldenDirectory.isDirectory())
+  {
+    result.failures.add ("no golden files: pass --golden DIR, or run from inside the source tree, which keeps them in Tests/golden");
+    return result;
+  }
+
+  const auto impulse = makeImpulse();
+  const auto noise = makeNoise();
+
+  for (const auto& testCase : makeCases())
+  {
+    ++result.numCases;
+
+    FilterBank bank;
+    updateFilterBank (bank, testCase.settings, testCase.sampleRate);
+
+    Sections sections;
+    const auto numSections = getExactSections (bank, sections);
+
+    FilterCascade cascade;
+    cascade.prepare (1, testCase.sampleRate);
+    const auto parallel = testCase.form == FilterCascade::Form::parallel;
+
+    if (parallel)
+      cascade.startParallelDesigner();
+
+    cascade.setForm (testCase.form);
+    cascade.setSections (bank);
+
+    if (parallel && numSections > 0 && ! waitForParallelForm (cascade))
+    {
+      result.failures.add (testCase.name + ": the parallel form was rejected or never delivered");
+      continue;
+    }
+
+    const auto nullLimit = parallel ? limits.parallelNullDb : limits.cascadeNullDb;
+    auto& worstNull = parallel ? result.worstParallelNullDb : result.worstCascadeNullDb;
+    const auto sweep = makeSweep (testCase.sampleRate);
+
+    for (const auto* input : { &impulse, &sweep, &noise })
+    {
+      auto output = *input;
+      render (cascade, output);
+
+      const auto reference = renderReference (sections, numSections, *input);
+      const auto nullDb = getNullDb (output, reference);
+      worstNull = juce::jmax (worstNull, nullDb);
+
+      const auto signalName = input == &impulse ? "impulse" : input == &sweep ? "sweep" : "noise";
+
+      if (nullDb > nullLimit)
+        result.failures.add (testCase.name + ": " + signalName + " nulls at "
+                             + juce::String (nullDb, 1) + " dB");
+
+      if (input != &impulse)
+        continue;
+
+      std::vector<Complex> response ((size_t) numResponsePoints);
+
+      for (int i = 0; i < numResponsePoints; ++i)
+        response[(size_t) i] = measuredResponse (output, juce::MathConstants<double>::twoPi
+                                                           * getResponseFrequency (i, testCase.sampleRate)
+                                                           / testCase.sampleRate);
+
+      const auto file = options.goldenDirectory.getChildFile (testCase.goldenName + ".txt");
+
+      if (options.updateGolden && ! parallel)
+      {
+        if (! writeGolden (file, testCase, response))
+          result.failures.add (testCase.name + ": cannot write " + file.getFullPathName());
+      }
+      else if (const auto error = compareWithGolden (file, testCase, response, limits, result); error.isNotEmpty())
+      {
+        result.failures.add (testCase.name + ": " + error);
+      }
+
+      // The bilinear design is checked against juce::dsp's own filters; the
+      // matched design has no counterpart there and is held to the designer's
+      // exact sections and to its golden file.
+      const auto matched = testCase.settings.hpFilter.design == design_matched;
+      const auto juceSections = matched ? juce::ReferenceCountedArray<JuceCoefficients>()
+                                        : designWithJuce (testCase.settings, testCase.sampleRate);
+
+      for (int i = 0; i < numResponsePoints; ++i)
+      {
+        const auto freq = getResponseFrequency (i, testCase.sampleRate);
+        const auto omega = juce::MathConstants<double>::twoPi * freq / testCase.sampleRate;
+
+        const auto expected = matched ? analyticResponse (sections.data(), numSections, omega)
+                                      : juceResponse (juceSections, omega);
+        const auto& measured = response[(size_t) i];
+
+        if (juce::Decibels::gainToDecibels (std::abs (expected), -400.0) < limits.responseFloorDb)
+          continue;
+
+        const auto magnitudeError = std::abs (juce::Decibels::gainToDecibels (std::abs (measured) / std::abs (expected), -400.0));
+        const auto phaseError = std::abs (juce::radiansToDegrees (std::arg (measured / expected)));
+
+        result.worstMagnitudeDb = juce::jmax (result.worstMagnitudeDb, magnitudeError);
+        result.worstPhaseDegrees = juce::jmax (result.worstPhaseDegrees, phaseError);
+
+        if (magnitudeError > limits.magnitudeDb || phaseError > limits.phaseDegrees)
+        {
+          result.failures.add (testCase.name + ": response at " + juce::String (freq, 1) + " Hz is off by "
+                               + juce::String (magnitudeError, 4) + " dB, "
+                               + juce::String (phaseError, 3) + " degrees");
+          break;
+        }
+      }
+    }
+  }
+
+  checkButterworth (limits, result);
+  checkChannelWorkerPool (result);
+  return result;
+}
+
+//==============================================================================
+bool isRequested (const juce::String& commandLine)
+{
+  return juce::StringArray::fromTokens (commandLine, true).contains ("--engine-check");
+}
+
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (arg == "--engine-check")
+      continue;
+
+    if (arg == "--update-golden")
+    {
+      options.updateGolden = true;
+      continue;
+    }
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--golden")
+      options.goldenDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (value);
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.goldenDirectory == juce::File())
+    options.goldenDirectory = findGoldenDirectory();
+
+  if (options.updateGolden && options.goldenDirectory == juce::File())
+    return "--update-golden needs --golden outside the source tree";
+
+  if (options.updateGolden && ! options.goldenDirectory.createDirectory())
+    return "cannot create " + options.goldenDirectory.getFullPathName();
+
+  if (options.goldenDirectory != juce::File() && ! options.goldenDirectory.isDirectory())
+    return "no golden directory at " + options.goldenDirectory.getFullPathName();
+
+  return {};
+}
+
+int run (const Options& options)
+{
+  const auto result = runChecks (options);
+  std::cout << "engine check: " << result.getSummary() << std::endl;
+
+  if (options.updateGolden && result.passed())
+    std::cout << "golden files written to " << options.goldenDirectory.getFullPathName() << std::endl;
+
+  return result.passed() ? 0 : 1;
+}
+}
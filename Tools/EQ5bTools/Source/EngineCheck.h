@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    EngineCheck.h
+    Null and response checks of the filter engine against a double precision
+    reference, juce::dsp's own filters and the golden files in Tests/golden.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Run by the EQ5bTools console program when the command line contains
+    --engine-check:
+
+        EQ5bTools --engine-check [--golden DIR] [--update-golden]
+
+    Renders fixed test signals (an impulse, a log sweep and white noise)
+    through FilterCascade for a grid of ChainSettings, sample rates up to
+    192 kHz, designs and forms, and compares every rendering with a double
+    precision direct form cascade of the FilterBank's preciseCoefficients, as
+    the designers computed them before rounding to float.
+
+    A case fails when the null test residual rises above the limit relative to
+    the reference peak, or when the magnitude or phase measured from the
+    impulse response drifts from the expected response by more than the limits
+    at frequencies where the response is above responseFloorDb. For the
+    bilinear design the expected response is that of the same settings built
+    from juce::dsp alone - IIR::Coefficients::makePeakFilter for the peaks and
+    FilterDesign's Butterworth cuts - so a mistake shared by the designers and
+    the reference cannot pass; juce::dsp has no matched design, so those cases
+    are checked against the exact sections.
+
+    The measured response of each case is also compared with its golden file,
+    so that any change to what the plugin sounds like shows up, whichever part
+    of the engine it comes from. The files live in Tests/golden, which is found
+    by walking up from the executable and then from the working directory;
+    --golden names another directory. A missing directory fails the check and
+    a missing or unreadable file fails its case. --update-golden rewrites the
+    files from the cascade form instead of comparing, and is the only way they
+    are created; both forms of a setting share one file.
+
+    The Butterworth cuts are checked against juce::dsp::FilterDesign: every
+    order of both cuts at a spread of rates and frequencies must match the
+    magnitude of the FilterDesign cascade within butterworthDb, and the time
+    each designer takes per filter is reported with the summary.
+
+    The channel worker pool is checked as well, with runs of alternating
+    group counts on a pool of its own: every group must run exactly once
+    before run() returns.
+
+    The summary is printed to stdout and every failure on its own line; the
+    exit code is 1 if any case failed, so the check can gate a build.
+*/
+namespace EngineCheck
+{
+  /** The defaults leave some headroom over what the engine rounds: with 24
+      bands at 192 kHz, the float sections just above the
+      needsDoublePrecision() threshold and the block matrices of the widest
+      kernels cost the cascade about -70 dB of null depth, and the float
+      parallel sum about -64 dB. A broken kernel, a wrongly mapped section or
+      a low cut run on rounded coefficients misses them by tens of dB. The
+      Butterworth sections and FilterDesign<double> are both designed in
+      double and only differ by its rounding; a wrong Q or prewarp misses by
+      whole decibels. The golden files are written with six decimals, and
+      the two forms of a setting agree with each other within hundredths of
+      a decibel and tenths of a degree.
+  */
+  struct Limits
+  {
+    double cascadeNullDb = -65.0;
+    double parallelNullDb = -55.0;
+    double goldenMagnitudeDb = 0.1;
+    double goldenPhaseDegrees = 1.0;
+    double magnitudeDb = 0.5;
+    double phaseDegrees = 2.0;
+    double responseFloorDb = -40.0;
+    double butterworthDb = 0.001;
+  };
+
+  struct Result
+  {
+    int numCases = 0;
+    juce::StringArray failures;
+    double worstCascadeNullDb = -400.0;
+    double worstParallelNullDb = -400.0;
+    double worstMagnitudeDb = 0.0;
+    double worstPhaseDegrees = 0.0;
+    double worstGoldenDb = 0.0;
+    double worstGoldenDegrees = 0.0;
+    double worstButterworthDb = 0.0;
+    double butterworthMicroseconds = 0.0;    // per filter, designButterworth
+    double filterDesignMicroseconds = 0.0;   // per filter, FilterDesign<float>
+
+    bool passed() const noexcept { return failures.isEmpty(); }
+    juce::String getSummary() const;
+  };
+
+  struct Options
+  {
+    Limits limits;
+    juce::File goldenDirectory;  // Tests/golden of the source tree if not set
+    bool updateGolden = false;
+  };
+
+  /** Runs every case and returns what failed. */
+  Result runChecks (const Options& options);
+
+  bool isRequested (const juce::String& commandLine);
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Runs the checks, prints the result and returns the process exit code: 1
+      if any case failed.
+  */
+  int run (const Options& options);
+}
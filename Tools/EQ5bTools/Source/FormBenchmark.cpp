@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    FormBenchmark.cpp
+    EQ5bTools mode that times the parallel form against the cascade for
+    each number of peak bands.
+
+  ==============================================================================
+*/
+
+#include "FormBenchmark.h"
+#include "PluginProcessor.h"
+#include "FilterCascade.h"
+#include <iostream>
+
+namespace FormBenchmark
+{
+namespace
+{
+  constexpr int warmUpBlocks = 100;
+  constexpr int maxDesignWaitMs = 2000;
+
+  ChainSettings makeSettings (int numBands)
+  {
+    ChainSettings settings;
+    settings.hpFilter.cutf = 20.f;
+    settings.lpFilter.cutf = 20000.f;
+    settings.numBands = numBands;
+
+    for (int band = 0; band < numBands; ++band)
+    {
+      auto& peak = settings.peaks[(size_t) band];
+      peak.freq = juce::mapToLog10 ((band + 0.5f) / (float) numBands, 40.f, 16000.f);
+      peak.gain = band % 2 == 0 ? 6.f : -6.f;
+      peak.q = 1.f;
+    }
+
+    return settings;
+  }
+
+  /** Feeds single frames of silence until the designer has delivered the
+      parallel form; returns how long that took in seconds, or -1 if it never
+      arrived or was rejected.
+  */
+  double waitForParallelForm (FilterCascade& cascade, int numChannels)
+  {
+    std::vector<float> silence ((size_t) numChannels, 0.f);
+    std::vector<float*> channels;
+
+    for (auto& sample : silence)
+      channels.push_back (&sample);
+
+    const auto start = juce::Time::getMillisecondCounterHiRes();
+
+    while (juce::Time::getMillisecondCounterHiRes() - start < maxDesignWaitMs)
+    {
+      juce::dsp::AudioBlock<float> block (channels.data(), channels.size(), 1);
+      cascade.process (juce::dsp::ProcessContextReplacing<float> (block));
+
+      if (cascade.isUsingParallelForm())
+        return (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+
+      std::fill (silence.begin(), silence.end(), 0.f);
+      juce::Thread::sleep (1);
+    }
+
+    return -1.0;
+  }
+
+  struct BlockTimes
+  {
+    double median = 0, p99 = 0;   // nanoseconds per frame
+  };
+
+  /** Times each block of noise after a warm-up. The buffer is refilled
+      between blocks, outside the timing, so every block sees the same input.
+  */
+  BlockTimes timeBlocks (FilterCascade& cascade, const juce::AudioBuffer<float>& noise,
+                         juce::AudioBuffer<float>& buffer, int numBlocks, std::vector<double>& seconds)
+  {
+    seconds.resize ((size_t) numBlocks);
+    cascade.reset();
+
+    for (int index = -warmUpBlocks; index < numBlocks; ++index)
+    {
+      for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        buffer.copyFrom (ch, 0, noise, ch, 0, buffer.getNumSamples());
+
+      juce::dsp::AudioBlock<float> block (buffer);
+
+      const auto start = juce::Time::getHighResolutionTicks();
+      cascade.process (juce::dsp::ProcessContextReplacing<float> (block));
+      const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+      if (index >= 0)
+        seconds[(size_t) index] = elapsed;
+    }
+
+    std::sort (seconds.begin(), seconds.end());
+
+    const auto toNanosecondsPerFrame = 1.0e9 / buffer.getNumSamples();
+    const auto p99Index = juce::jmin (seconds.size() - 1, (size_t) (0.99 * (double) seconds.size()));
+    return { seconds[seconds.size() / 2] * toNanosecondsPerFrame, seconds[p99Index] * toNanosecondsPerFrame };
+  }
+
+  juce::String format (const BlockTimes& times)
+  {
+    return juce::String (times.median, 2) + " / " + juce::String (times.p99, 2) + " ns";
+  }
+}
+
+//==============================================================================
+bool isRequested (const juce::String& commandLine)
+{
+  return juce::StringArray::fromTokens (commandLine, true).contains ("--forms");
+}
+
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (arg == "--forms")
+      continue;
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--rate")
+      options.sampleRate = value.getDoubleValue();
+    else if (arg == "--block")
+      options.blockSize = value.getIntValue();
+    else if (arg == "--channels")
+      options.numChannels = value.getIntValue();
+    else if (arg == "--seconds")
+      options.seconds = value.getDoubleValue();
+    else if (arg == "--bands")
+    {
+      options.bandCounts.clear();
+
+      for (const auto& count : juce::StringArray::fromTokens (value, ",", {}))
+        options.bandCounts.add (count.getIntValue());
+    }
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.bandCounts.isEmpty())
+    return "--bands needs at least one count";
+
+  for (const auto count : options.bandCounts)
+    if (count < 1 || count > maxPeakBands)
+      return "every band count must be between 1 and " + juce::String (maxPeakBands);
+
+  if (options.sampleRate < 8000.0 || options.sampleRate > 768000.0)
+    return "--rate must be between 8000 and 768000";
+
+  if (options.blockSize < 1 || options.blockSize > 1 << 16)
+    return "--block must be between 1 and 65536";
+
+  if (options.numChannels < 1 || options.numChannels > 64)
+    return "--channels must be between 1 and 64";
+
+  if (options.seconds <= 0.0)
+    return "--seconds must be positive";
+
+  return {};
+}
+
+int run (const Options& options)
+{
+  const auto numBlocks = juce::jmax (1, juce::roundToInt (options.seconds * options.sampleRate / options.blockSize));
+
+  juce::Random random (1);
+  juce::AudioBuffer<float> noise (options.numChannels, options.blockSize);
+  juce::AudioBuffer<float> buffer (options.numChannels, options.blockSize);
+  std::vector<double> seconds;
+
+  for (int ch = 0; ch < options.numChannels; ++ch)
+    for (int i = 0; i < options.blockSize; ++i)
+      noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+  std::cout << options.numChannels << " channels, " << options.sampleRate << " Hz, " << options.blockSize
+            << " frames per block, " << numBlocks << " blocks per form; median / p99 per frame" << std::endl;
+
+  for (const auto numBands : options.bandCounts)
+  {
+    FilterBank bank;
+    updateFilterBank (bank, makeSettings (numBands), options.sampleRate);
+
+    FilterCascade cascade;
+    cascade.prepare (options.numChannels, options.sampleRate);
+    cascade.setSections (bank);
+
+    const auto cascadeTimes = timeBlocks (cascade, noise, buffer, numBlocks, seconds);
+
+    std::cout << numBands << " bands, " << cascade.getNumActiveSections() << " sections: cascade "
+              << format (cascadeTimes);
+
+    cascade.startParallelDesigner();
+    cascade.setForm (FilterCascade::Form::parallel);
+    const auto designSeconds = waitForParallelForm (cascade, options.numChannels);
+
+    if (designSeconds < 0.0)
+    {
+      std::cout << ", parallel form rejected" << std::endl;
+      continue;
+    }
+
+    const auto parallelTimes = timeBlocks (cascade, noise, buffer, numBlocks, seconds);
+
+    std::cout << ", parallel " << format (parallelTimes) << ", ratio "
+              << juce::String (parallelTimes.median / cascadeTimes.median, 2) << ", designed in "
+              << juce::String (designSeconds * 1000.0, 1) << " ms" << std::endl;
+  }
+
+  return 0;
+}
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    FormBenchmark.h
+    EQ5bTools mode that times the parallel form against the cascade for
+    each number of peak bands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Run by the EQ5bTools console program when the command line contains
+    --forms:
+
+        EQ5bTools --forms [--bands N,N,...] [--rate HZ] [--block FRAMES]
+                          [--channels N] [--seconds S]
+
+    For each band count, a FilterCascade with that many peaks and the default
+    cuts runs the same noise in cascade form and then in parallel form, one
+    block at a time on this thread, without channel workers. One line per
+    count gives the number of sections, the median and 99th percentile block
+    time of each form in nanoseconds per frame, the ratio of the medians, and
+    how long the background designer took to deliver the parallel form; a
+    count whose parallel form is rejected is reported as such and timed in
+    cascade form only.
+*/
+namespace FormBenchmark
+{
+  struct Options
+  {
+    juce::Array<int> bandCounts { 1, 2, 3, 4, 6, 8, 12, 16, 20, 24 };
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    int numChannels = 2;
+    double seconds = 10.0;        // of audio per form and band count
+  };
+
+  bool isRequested (const juce::String& commandLine);
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Times every band count and returns the process exit code, 0. */
+  int run (const Options& options);
+}
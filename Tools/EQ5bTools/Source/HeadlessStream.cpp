@@ -0,0 +1,466 @@
+/*
+  ==============================================================================
+
+    HeadlessStream.cpp
+    EQ5bTools mode without a GUI or audio device that filters raw interleaved
+    PCM from stdin or a named pipe to stdout.
+
+  ==============================================================================
+*/
+
+#include "HeadlessStream.h"
+#include <iostream>
+
+#if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+ #include <cerrno>
+ #include <csignal>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+
+namespace HeadlessStream
+{
+namespace
+{
+  using namespace juce::AudioData;
+
+  template <typename SampleType>
+  using InterleavedSource = Pointer<SampleType, LittleEndian, Interleaved, Const>;
+
+  template <typename SampleType>
+  using InterleavedDest = Pointer<SampleType, LittleEndian, Interleaved, NonConst>;
+
+  using PlanarSource = Pointer<Float32, NativeEndian, NonInterleaved, Const>;
+  using PlanarDest = Pointer<Float32, NativeEndian, NonInterleaved, NonConst>;
+
+  struct Converters
+  {
+    std::unique_ptr<Converter> deinterleave, interleave;
+    int bytesPerSample = 0;
+  };
+
+  template <typename SampleType>
+  Converters makeConverters (int numChannels)
+  {
+    return { std::make_unique<ConverterInstance<InterleavedSource<SampleType>, PlanarDest>> (numChannels, 1),
+             std::make_unique<ConverterInstance<PlanarSource, InterleavedDest<SampleType>>> (1, numChannels),
+             (int) SampleType::bytesPerSample };
+  }
+
+  Converters makeConverters (SampleFormat format, int numChannels)
+  {
+    switch (format)
+    {
+      case SampleFormat::int16:   return makeConverters<Int16> (numChannels);
+      case SampleFormat::int24:   return makeConverters<Int24> (numChannels);
+      case SampleFormat::int32:   return makeConverters<Int32> (numChannels);
+      case SampleFormat::float32: break;
+    }
+
+    return makeConverters<Float32> (numChannels);
+  }
+
+  //==============================================================================
+  juce::String loadPreset (juce::AudioProcessor& processor, const juce::File& file)
+  {
+    juce::MemoryBlock data;
+
+    if (! file.loadFileAsData (data))
+      return "cannot read the preset " + file.getFullPathName();
+
+    const auto* bytes = static_cast<const char*> (data.getData());
+    const auto* end = bytes + data.getSize();
+
+    while (bytes != end && juce::CharacterFunctions::isWhitespace (*bytes))
+      ++bytes;
+
+    // Anything that does not look like XML is taken to be a saved binary state.
+    if (bytes != end && *bytes == '<')
+    {
+      const auto xml = juce::parseXML (data.toString());
+
+      if (xml == nullptr)
+        return "the preset " + file.getFullPathName() + " is not valid XML";
+
+      data.reset();
+      juce::MemoryOutputStream stream (data, false);
+      juce::ValueTree::fromXml (*xml).writeToStream (stream);
+    }
+
+    processor.setStateInformation (data.getData(), (int) data.getSize());
+    return {};
+  }
+
+  void applyControlLine (juce::AudioProcessor& processor, const juce::String& line)
+  {
+    const auto tokens = juce::StringArray::fromTokens (line.trim(), false);
+
+    if (tokens.isEmpty())
+      return;
+
+    if (tokens.size() == 2)
+    {
+      for (auto* parameter : processor.getParameters())
+      {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+        {
+          if (ranged->paramID == tokens[0])
+          {
+            ranged->setValueNotifyingHost (ranged->convertTo0to1 (tokens[1].getFloatValue()));
+            return;
+          }
+        }
+      }
+    }
+
+    std::cerr << "EQ5b: ignoring control line \"" << line.trim() << "\"" << std::endl;
+  }
+
+ #if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+  /** Waits for the descriptor to become readable, giving up after 100 ms. */
+  bool waitForInput (int fd)
+  {
+    pollfd request { fd, POLLIN, 0 };
+    return poll (&request, 1, 100) > 0;
+  }
+
+  bool writeFully (int fd, const char* data, size_t numBytes)
+  {
+    while (numBytes > 0)
+    {
+      const auto written = ::write (fd, data, numBytes);
+
+      if (written < 0 && errno == EINTR)
+        continue;
+
+      if (written <= 0)
+        return false;
+
+      data += written;
+      numBytes -= (size_t) written;
+    }
+
+    return true;
+  }
+
+  //==============================================================================
+  struct Chunk
+  {
+    juce::HeapBlock<char> data;
+    int numFrames = 0;
+    juce::WaitableEvent filled, drained;
+  };
+
+  /** Fills the two chunks in turn, each once the processing side has drained it.
+      A chunk with no frames marks the end of the input.
+  */
+  class Reader : public juce::Thread
+  {
+  public:
+    Reader (int inputFd, std::array<Chunk, 2>& chunksToFill, size_t bytesPerFrame, int framesPerChunk)
+      : juce::Thread ("EQ5b stream reader"),
+        fd (inputFd), chunks (chunksToFill), frameBytes (bytesPerFrame), chunkFrames (framesPerChunk)
+    {
+    }
+
+    ~Reader() override
+    {
+      signalThreadShouldExit();
+
+      for (auto& chunk : chunks)
+        chunk.drained.signal();
+
+      stopThread (1000);
+    }
+
+  private:
+    void run() override
+    {
+      for (size_t index = 0; ! threadShouldExit(); index ^= 1)
+      {
+        auto& chunk = chunks[index];
+        chunk.drained.wait (-1);
+
+        if (threadShouldExit())
+          break;
+
+        chunk.numFrames = readFrames (chunk.data);
+        chunk.filled.signal();
+
+        if (chunk.numFrames == 0)
+          break;
+      }
+    }
+
+    int readFrames (char* data)
+    {
+      const auto numBytes = frameBytes * (size_t) chunkFrames;
+      size_t numRead = 0;
+
+      while (numRead < numBytes && ! threadShouldExit())
+      {
+        if (! waitForInput (fd))
+          continue;
+
+        const auto result = ::read (fd, data + numRead, numBytes - numRead);
+
+        if (result < 0 && errno == EINTR)
+          continue;
+
+        if (result <= 0)
+          break;
+
+        numRead += (size_t) result;
+      }
+
+      // A partial frame can only be left over at the end of the input.
+      return (int) (numRead / frameBytes);
+    }
+
+    const int fd;
+    std::array<Chunk, 2>& chunks;
+    const size_t frameBytes;
+    const int chunkFrames;
+
+    JUCE_DECLARE_NON_COPYABLE (Reader)
+  };
+
+  /** Applies "<parameter ID> <value>" lines from the FIFO as they arrive. The
+      FIFO is opened for reading and writing so that it neither blocks until a
+      writer appears nor reports the end of the input when a writer goes away.
+  */
+  class ControlReader : public juce::Thread
+  {
+  public:
+    ControlReader (juce::AudioProcessor& processorToControl, int controlFd)
+      : juce::Thread ("EQ5b stream control"), processor (processorToControl), fd (controlFd)
+    {
+    }
+
+    ~ControlReader() override
+    {
+      stopThread (1000);
+    }
+
+  private:
+    void run() override
+    {
+      char bytes[256];
+
+      while (! threadShouldExit())
+      {
+        if (! waitForInput (fd))
+          continue;
+
+        const auto result = ::read (fd, bytes, sizeof (bytes));
+
+        if (result <= 0)
+        {
+          wait (100);
+          continue;
+        }
+
+        pending += juce::String::fromUTF8 (bytes, (int) result);
+
+        for (auto end = pending.indexOfChar ('\n'); end >= 0; end = pending.indexOfChar ('\n'))
+        {
+          applyControlLine (processor, pending.substring (0, end));
+          pending = pending.substring (end + 1);
+        }
+      }
+    }
+
+    juce::AudioProcessor& processor;
+    const int fd;
+    juce::String pending;
+
+    JUCE_DECLARE_NON_COPYABLE (ControlReader)
+  };
+ #endif
+}
+
+//==============================================================================
+bool isRequested (const juce::String& commandLine)
+{
+  return juce::StringArray::fromTokens (commandLine, true).contains ("--headless");
+}
+
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (arg == "--headless")
+      continue;
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--channels")
+      options.numChannels = value.getIntValue();
+    else if (arg == "--rate")
+      options.sampleRate = value.getDoubleValue();
+    else if (arg == "--chunk")
+      options.chunkFrames = value.getIntValue();
+    else if (arg == "--input")
+      options.input = juce::File::getCurrentWorkingDirectory().getChildFile (value);
+    else if (arg == "--preset")
+      options.preset = juce::File::getCurrentWorkingDirectory().getChildFile (value);
+    else if (arg == "--control")
+      options.controlFifo = juce::File::getCurrentWorkingDirectory().getChildFile (value);
+    else if (arg == "--format")
+    {
+      if (value == "f32")      options.format = SampleFormat::float32;
+      else if (value == "s16") options.format = SampleFormat::int16;
+      else if (value == "s24") options.format = SampleFormat::int24;
+      else if (value == "s32") options.format = SampleFormat::int32;
+      else return "unknown sample format " + value;
+    }
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.numChannels < 1 || options.numChannels > 64)
+    return "--channels must be between 1 and 64";
+
+  if (options.sampleRate < 8000.0 || options.sampleRate > 768000.0)
+    return "--rate must be between 8000 and 768000";
+
+  if (options.chunkFrames < 16 || options.chunkFrames > 1 << 20)
+    return "--chunk must be between 16 and 1048576 frames";
+
+  return {};
+}
+
+int run (const Options& options)
+{
+ #if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+  auto fail = [] (const juce::String& message)
+  {
+    std::cerr << "EQ5b: " << message << std::endl;
+    return 1;
+  };
+
+  std::unique_ptr<juce::AudioProcessor> processor (createPluginFilter());
+  processor->setPlayConfigDetails (options.numChannels, options.numChannels, options.sampleRate, options.chunkFrames);
+
+  if (processor->getTotalNumInputChannels() != options.numChannels
+      || processor->getTotalNumOutputChannels() != options.numChannels)
+    return fail ("cannot process " + juce::String (options.numChannels) + " channels");
+
+  if (options.preset != juce::File())
+    if (const auto error = loadPreset (*processor, options.preset); error.isNotEmpty())
+      return fail (error);
+
+  const auto inputFd = options.input == juce::File() ? STDIN_FILENO
+                                                     : ::open (options.input.getFullPathName().toRawUTF8(), O_RDONLY);
+
+  if (inputFd < 0)
+    return fail ("cannot open " + options.input.getFullPathName());
+
+  auto controlFd = -1;
+
+  if (options.controlFifo != juce::File())
+  {
+    const auto path = options.controlFifo.getFullPathName();
+
+    if (! options.controlFifo.exists())
+      mkfifo (path.toRawUTF8(), 0600);
+
+    controlFd = ::open (path.toRawUTF8(), O_RDWR | O_NONBLOCK);
+
+    if (controlFd < 0)
+      return fail ("cannot open the control FIFO " + path);
+  }
+
+  // A closed downstream pipe should end the stream, not the process.
+  std::signal (SIGPIPE, SIG_IGN);
+
+  const auto converters = makeConverters (options.format, options.numChannels);
+  const auto frameBytes = (size_t) (converters.bytesPerSample * options.numChannels);
+
+  std::array<Chunk, 2> chunks;
+
+  for (auto& chunk : chunks)
+  {
+    chunk.data.allocate (frameBytes * (size_t) options.chunkFrames, true);
+    chunk.drained.signal();
+  }
+
+  juce::AudioBuffer<float> buffer (options.numChannels, options.chunkFrames);
+  juce::MidiBuffer midi;
+
+  processor->prepareToPlay (options.sampleRate, options.chunkFrames);
+
+  auto exitCode = 0;
+
+  {
+    std::unique_ptr<ControlReader> control;
+
+    if (controlFd >= 0)
+    {
+      control = std::make_unique<ControlReader> (*processor, controlFd);
+      control->startThread (juce::Thread::Priority::low);
+    }
+
+    Reader reader (inputFd, chunks, frameBytes, options.chunkFrames);
+    reader.startThread (juce::Thread::Priority::high);
+
+    for (size_t index = 0;; index ^= 1)
+    {
+      auto& chunk = chunks[index];
+      chunk.filled.wait (-1);
+
+      const auto numFrames = chunk.numFrames;
+
+      if (numFrames == 0)
+        break;
+
+      // Shrinking for the last, partial chunk keeps the allocation.
+      if (numFrames != buffer.getNumSamples())
+        buffer.setSize (options.numChannels, numFrames, false, false, true);
+
+      for (int ch = 0; ch < options.numChannels; ++ch)
+        converters.deinterleave->convertSamples (buffer.getWritePointer (ch), 0, chunk.data, ch, numFrames);
+
+      midi.clear();
+      processor->processBlock (buffer, midi);
+
+      for (int ch = 0; ch < options.numChannels; ++ch)
+        converters.interleave->convertSamples (chunk.data, ch, buffer.getReadPointer (ch), 0, numFrames);
+
+      if (! writeFully (STDOUT_FILENO, chunk.data, frameBytes * (size_t) numFrames))
+      {
+        exitCode = fail ("cannot write the output");
+        break;
+      }
+
+      chunk.drained.signal();
+    }
+  }
+
+  processor->releaseResources();
+
+  if (inputFd != STDIN_FILENO)
+    ::close (inputFd);
+
+  if (controlFd >= 0)
+    ::close (controlFd);
+
+  return exitCode;
+ #else
+  juce::ignoreUnused (options);
+  std::cerr << "EQ5b: headless streaming needs a POSIX platform" << std::endl;
+  return 1;
+ #endif
+}
+}
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    HeadlessStream.h
+    EQ5bTools mode without a GUI or audio device that filters raw interleaved
+    PCM from stdin or a named pipe to stdout.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Run by the EQ5bTools console program when the command line contains
+    --headless:
+
+        EQ5bTools --headless [--channels N] [--rate HZ] [--format f32|s16|s24|s32]
+                             [--chunk FRAMES] [--input PATH] [--preset FILE]
+                             [--control FIFO]
+
+    Samples are little-endian and interleaved, in the same format on both ends.
+    The preset is either a state saved by the standalone window or the XML of
+    that state. Each line written to the control FIFO is a parameter ID and a
+    value in the parameter's own units, e.g. "hpFreq 80".
+
+    A reader thread fills one of two interleaved chunks while the calling thread
+    deinterleaves, filters, reinterleaves and writes the other one in place, so
+    the only copies are the de/interleaving conversions. Everything is
+    allocated before the first chunk is read.
+*/
+namespace HeadlessStream
+{
+  enum class SampleFormat
+  {
+    float32,
+    int16,
+    int24,
+    int32
+  };
+
+  struct Options
+  {
+    int numChannels = 2;
+    double sampleRate = 48000.0;
+    SampleFormat format = SampleFormat::float32;
+    int chunkFrames = 4096;
+    juce::File input;            // stdin if this is not set
+    juce::File preset;
+    juce::File controlFifo;
+  };
+
+  bool isRequested (const juce::String& commandLine);
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Streams until the input ends and returns the process exit code. */
+  int run (const Options& options);
+}
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    InstanceFootprint.cpp
+    EQ5bTools mode that measures the memory and start-up time of many
+    processor instances, as a large session would load them.
+
+  ==============================================================================
+*/
+
+#include "InstanceFootprint.h"
+#include <iostream>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+
+namespace InstanceFootprint
+{
+namespace
+{
+  /** The resident set size in bytes, or -1 where it cannot be read. */
+  juce::int64 getResidentBytes()
+  {
+   #if JUCE_LINUX
+    const auto fields = juce::StringArray::fromTokens (juce::File ("/proc/self/statm").loadFileAsString(), true);
+
+    if (fields.size() > 1)
+      return fields[1].getLargeIntValue() * (juce::int64) sysconf (_SC_PAGESIZE);
+   #endif
+
+    return -1;
+  }
+
+  double getSeconds (juce::int64 startTicks, juce::int64 endTicks)
+  {
+    return juce::Time::highResolutionTicksToSeconds (endTicks - startTicks);
+  }
+
+  void report (const char* stage, juce::int64 bytesBefore, juce::int64 bytesAfter, double seconds, int numInstances)
+  {
+    std::cout << stage << ": ";
+
+    if (bytesBefore >= 0 && bytesAfter >= 0)
+      std::cout << (bytesAfter - bytesBefore) / numInstances << " bytes";
+    else
+      std::cout << "n/a bytes";
+
+    std::cout << " and " << juce::String (seconds * 1.0e6 / numInstances, 1) << " us per instance" << std::endl;
+  }
+}
+
+//==============================================================================
+bool isRequested (const juce::String& commandLine)
+{
+  return juce::StringArray::fromTokens (commandLine, true).contains ("--footprint");
+}
+
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (arg == "--footprint")
+      continue;
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--instances")
+      options.numInstances = value.getIntValue();
+    else if (arg == "--channels")
+      options.numChannels = value.getIntValue();
+    else if (arg == "--rate")
+      options.sampleRate = value.getDoubleValue();
+    else if (arg == "--block")
+      options.blockSize = value.getIntValue();
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.numInstances < 1 || options.numInstances > 100000)
+    return "--instances must be between 1 and 100000";
+
+  if (options.numChannels < 1 || options.numChannels > 64)
+    return "--channels must be between 1 and 64";
+
+  if (options.sampleRate < 8000.0 || options.sampleRate > 768000.0)
+    return "--rate must be between 8000 and 768000";
+
+  if (options.blockSize < 1 || options.blockSize > 1 << 16)
+    return "--block must be between 1 and 65536";
+
+  return {};
+}
+
+int run (const Options& options)
+{
+  const auto numInstances = (size_t) options.numInstances;
+  std::vector<std::unique_ptr<juce::AudioProcessor>> processors (numInstances);
+  std::vector<juce::int64> created (numInstances);
+
+  juce::AudioBuffer<float> buffer (options.numChannels, options.blockSize);
+  juce::MidiBuffer midi;
+  juce::Random random (1);
+
+  // The first instance also starts what every instance shares, such as the
+  // worker threads and the kernel table; it is left out of the figures.
+  {
+    std::unique_ptr<juce::AudioProcessor> warmUp (createPluginFilter());
+  }
+
+  const auto bytesAtStart = getResidentBytes();
+  const auto startTicks = juce::Time::getHighResolutionTicks();
+
+  for (size_t i = 0; i < numInstances; ++i)
+  {
+    created[i] = juce::Time::getHighResolutionTicks();
+    processors[i].reset (createPluginFilter());
+    processors[i]->setPlayConfigDetails (options.numChannels, options.numChannels, options.sampleRate, options.blockSize);
+  }
+
+  const auto bytesCreated = getResidentBytes();
+  const auto createdTicks = juce::Time::getHighResolutionTicks();
+
+  for (auto& processor : processors)
+    processor->prepareToPlay (options.sampleRate, options.blockSize);
+
+  const auto bytesPrepared = getResidentBytes();
+  const auto preparedTicks = juce::Time::getHighResolutionTicks();
+
+  auto totalToFirstBlock = 0.0, worstToFirstBlock = 0.0;
+
+  for (size_t i = 0; i < numInstances; ++i)
+  {
+    for (int ch = 0; ch < options.numChannels; ++ch)
+      for (int s = 0; s < options.blockSize; ++s)
+        buffer.setSample (ch, s, random.nextFloat() * 0.5f - 0.25f);
+
+    midi.clear();
+    processors[i]->processBlock (buffer, midi);
+
+    const auto toFirstBlock = getSeconds (created[i], juce::Time::getHighResolutionTicks());
+    totalToFirstBlock += toFirstBlock;
+    worstToFirstBlock = juce::jmax (worstToFirstBlock, toFirstBlock);
+  }
+
+  const auto bytesProcessed = getResidentBytes();
+  const auto processedTicks = juce::Time::getHighResolutionTicks();
+
+  std::cout << options.numInstances << " instances, " << options.numChannels << " channels, "
+            << options.sampleRate << " Hz, " << options.blockSize << " samples" << std::endl;
+
+  report ("construct", bytesAtStart, bytesCreated, getSeconds (startTicks, createdTicks), options.numInstances);
+  report ("prepare", bytesCreated, bytesPrepared, getSeconds (createdTicks, preparedTicks), options.numInstances);
+  report ("first block", bytesPrepared, bytesProcessed, getSeconds (preparedTicks, processedTicks), options.numInstances);
+  report ("total", bytesAtStart, bytesProcessed, getSeconds (startTicks, processedTicks), options.numInstances);
+
+  // Each instance waits for the ones created after it, so the worst case
+  // includes the whole session's start-up, as it does in a host.
+  std::cout << "construction to first block: average "
+            << juce::String (totalToFirstBlock * 1.0e3 / options.numInstances, 2) << " ms, worst "
+            << juce::String (worstToFirstBlock * 1.0e3, 2) << " ms" << std::endl;
+
+  for (auto& processor : processors)
+    processor->releaseResources();
+
+  return 0;
+}
+}
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    InstanceFootprint.h
+    EQ5bTools mode that measures the memory and start-up time of many
+    processor instances, as a large session would load them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Run by the EQ5bTools console program when the command line contains
+    --footprint:
+
+        EQ5bTools --footprint [--instances N] [--channels N] [--rate HZ]
+                              [--block FRAMES]
+
+    Creates the instances one after another, then prepares each and runs one
+    block of noise through it, and reports the resident memory each stage
+    added per instance along with the time each stage took per instance, and
+    the average and worst time from constructing an instance to its first
+    processed block. The resident size is read from /proc, so it is only
+    reported on Linux.
+*/
+namespace InstanceFootprint
+{
+  struct Options
+  {
+    int numInstances = 300;
+    int numChannels = 2;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+  };
+
+  bool isRequested (const juce::String& commandLine);
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Returns the process exit code. */
+  int run (const Options& options);
+}
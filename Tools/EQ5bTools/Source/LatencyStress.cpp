@@ -0,0 +1,404 @@
+/*
+  ==============================================================================
+
+    LatencyStress.cpp
+    EQ5bTools mode that measures the tail of the per-block execution time
+    while parameters, states and sample rates change underneath the processor.
+
+  ==============================================================================
+*/
+
+#include "LatencyStress.h"
+#include <iostream>
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+
+namespace LatencyStress
+{
+namespace
+{
+  struct BlockTiming
+  {
+    float load = 0.f;       // execution time over the block's real time
+    float seconds = 0.f;
+    int numSamples = 0;
+  };
+
+  /** Runs blocks back to back at whatever rate the processor was last
+      prepared for. Timings go into storage reserved before each rate starts,
+      so the loop itself allocates nothing; when it is full, the loop idles
+      until the next rate.
+  */
+  class AudioLoop : public juce::Thread
+  {
+  public:
+    AudioLoop (juce::AudioProcessor& processorToRun, const Options& runOptions)
+      : juce::Thread ("EQ5b stress audio"), processor (processorToRun), options (runOptions),
+        timings ((size_t) runOptions.sampleRates.size())
+    {
+    }
+
+    ~AudioLoop() override
+    {
+      stopThread (10000);
+    }
+
+    /** Called from the thread that prepares the processor: no block runs
+        between the two calls, as no host calls processBlock while it
+        prepares. Between a rate's resume and the next pause, its blocks are
+        timed; resuming with -1 leaves the loop idle.
+    */
+    void pause()
+    {
+      rateIndex.store (-1);
+      prepareLock.enter();
+    }
+
+    void resume (int newRateIndex)
+    {
+      // At most one block per minimum block size of audio fits in real time
+      // at any load below 100%; anything faster stops the rate early.
+      if (newRateIndex >= 0)
+        timings[(size_t) newRateIndex].reserve ((size_t) (options.secondsPerRate * options.sampleRates[newRateIndex]
+                                                          / options.minBlockSize) + 1);
+
+      rateIndex.store (newRateIndex);
+      prepareLock.exit();
+      notify();
+    }
+
+    /** Valid once the thread has finished. */
+    std::vector<BlockTiming>& getTimings (int index) { return timings[(size_t) index]; }
+
+  private:
+    void run() override
+    {
+      juce::Random random (options.seed);
+      juce::AudioBuffer<float> noise (options.numChannels, options.maxBlockSize);
+      juce::AudioBuffer<float> buffer (options.numChannels, options.maxBlockSize);
+      juce::MidiBuffer midi;
+
+      for (int ch = 0; ch < options.numChannels; ++ch)
+        for (int i = 0; i < options.maxBlockSize; ++i)
+          noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+      while (! threadShouldExit())
+      {
+        const auto index = rateIndex.load();
+
+        if (index < 0 || timings[(size_t) index].size() == timings[(size_t) index].capacity())
+        {
+          wait (5);
+          continue;
+        }
+
+        // The rate may have changed while this waited for the lock.
+        const juce::ScopedLock sl (prepareLock);
+
+        if (rateIndex.load() != index)
+          continue;
+
+        auto& results = timings[(size_t) index];
+        const auto sampleRate = options.sampleRates[index];
+        const auto numSamples = random.nextInt (juce::Range<int> (options.minBlockSize, options.maxBlockSize + 1));
+        buffer.setSize (options.numChannels, numSamples, false, false, true);
+
+        for (int ch = 0; ch < options.numChannels; ++ch)
+          buffer.copyFrom (ch, 0, noise, ch, 0, numSamples);
+
+        midi.clear();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock (buffer, midi);
+        const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        results.push_back ({ (float) (seconds * sampleRate / numSamples), (float) seconds, numSamples });
+      }
+    }
+
+    juce::AudioProcessor& processor;
+    const Options& options;
+    std::vector<std::vector<BlockTiming>> timings;
+
+    juce::CriticalSection prepareLock;
+    std::atomic<int> rateIndex { -1 };   // -1 while paused
+
+    JUCE_DECLARE_NON_COPYABLE (AudioLoop)
+  };
+
+  /** Prepares the processor for each rate in turn and lets the audio loop run
+      it for the given number of seconds. This runs on a thread of its own, as
+      a host's device change does, so it races the automation and the message
+      thread rather than taking turns with them.
+  */
+  class RateChanges : public juce::Thread
+  {
+  public:
+    RateChanges (juce::AudioProcessor& processorToPrepare, AudioLoop& loop, const Options& runOptions)
+      : juce::Thread ("EQ5b stress rates"), processor (processorToPrepare), audio (loop), options (runOptions)
+    {
+    }
+
+    ~RateChanges() override
+    {
+      stopThread (10000);
+    }
+
+  private:
+    void run() override
+    {
+      for (int index = 0; index < options.sampleRates.size() && ! threadShouldExit(); ++index)
+      {
+        const auto sampleRate = options.sampleRates[index];
+
+        audio.pause();
+        processor.setPlayConfigDetails (options.numChannels, options.numChannels, sampleRate, options.maxBlockSize);
+        processor.prepareToPlay (sampleRate, options.maxBlockSize);
+        audio.resume (index);
+
+        wait ((int) (options.secondsPerRate * 1000.0));
+      }
+
+      audio.pause();
+      processor.releaseResources();
+      audio.resume (-1);
+    }
+
+    juce::AudioProcessor& processor;
+    AudioLoop& audio;
+    const Options& options;
+
+    JUCE_DECLARE_NON_COPYABLE (RateChanges)
+  };
+
+  /** Moves a random parameter to a random value about once a millisecond, as a
+      host playing back dense automation would.
+  */
+  class Automation : public juce::Thread
+  {
+  public:
+    Automation (juce::AudioProcessor& processorToAutomate, juce::int64 seed)
+      : juce::Thread ("EQ5b stress automation"), processor (processorToAutomate), random (seed)
+    {
+    }
+
+    ~Automation() override
+    {
+      stopThread (1000);
+    }
+
+  private:
+    void run() override
+    {
+      const auto& parameters = processor.getParameters();
+
+      while (! threadShouldExit() && ! parameters.isEmpty())
+      {
+        parameters[random.nextInt (parameters.size())]->setValueNotifyingHost (random.nextFloat());
+        wait (1);
+      }
+    }
+
+    juce::AudioProcessor& processor;
+    juce::Random random;
+
+    JUCE_DECLARE_NON_COPYABLE (Automation)
+  };
+
+  /** Saves and restores whole states every 20 ms on the message thread, as
+      an editor loading presets would, and stops the dispatch loop once the
+      last rate has run.
+  */
+  class StateChanges : private juce::Timer
+  {
+  public:
+    StateChanges (juce::AudioProcessor& processorToChange, const juce::Thread& rateChanges, juce::int64 seed)
+      : processor (processorToChange), rates (rateChanges), random (seed)
+    {
+      // A few states to restore: the defaults, and whatever automation leaves
+      // behind later on.
+      processor.getStateInformation (states[0]);
+
+      for (size_t i = 1; i < states.size(); ++i)
+        states[i] = states[0];
+
+      startTimer (20);
+    }
+
+  private:
+    void timerCallback() override
+    {
+      if (! rates.isThreadRunning())
+      {
+        stopTimer();
+        juce::MessageManager::getInstance()->stopDispatchLoop();
+        return;
+      }
+
+      auto& state = states[(size_t) random.nextInt ((int) states.size())];
+
+      if (random.nextBool())
+      {
+        processor.setStateInformation (state.getData(), (int) state.getSize());
+      }
+      else
+      {
+        state.reset();
+        processor.getStateInformation (state);
+      }
+    }
+
+    juce::AudioProcessor& processor;
+    const juce::Thread& rates;
+    juce::Random random;
+    std::array<juce::MemoryBlock, 4> states;
+
+    JUCE_DECLARE_NON_COPYABLE (StateChanges)
+  };
+
+  float getPercentile (const std::vector<BlockTiming>& sorted, double fraction)
+  {
+    const auto index = juce::jlimit<size_t> (0, sorted.size() - 1, (size_t) (fraction * (double) sorted.size()));
+    return sorted[index].load;
+  }
+
+  /** Prints the rate's line and returns the worst load. */
+  float report (double sampleRate, std::vector<BlockTiming>& results)
+  {
+    if (results.empty())
+    {
+      std::cout << sampleRate << " Hz: no blocks" << std::endl;
+      return 0.f;
+    }
+
+    std::sort (results.begin(), results.end(), [] (const auto& a, const auto& b) { return a.load < b.load; });
+
+    const auto& worst = results.back();
+    auto percent = [] (float load) { return juce::String (100.0 * load, 2) + "%"; };
+
+    std::cout << sampleRate << " Hz: " << results.size() << " blocks, load"
+              << " p50 " << percent (getPercentile (results, 0.5))
+              << " p99 " << percent (getPercentile (results, 0.99))
+              << " p99.9 " << percent (getPercentile (results, 0.999))
+              << " max " << percent (worst.load)
+              << ", jitter " << percent (getPercentile (results, 0.999) - getPercentile (results, 0.5))
+              << ", slowest " << juce::String (worst.seconds * 1.0e6, 1) << " us for "
+              << worst.numSamples << " samples" << std::endl;
+
+    return worst.load;
+  }
+}
+
+//==============================================================================
+bool isRequested (const juce::String& commandLine)
+{
+  return juce::StringArray::fromTokens (commandLine, true).contains ("--stress");
+}
+
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (arg == "--stress")
+      continue;
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--seconds")
+      options.secondsPerRate = value.getDoubleValue();
+    else if (arg == "--channels")
+      options.numChannels = value.getIntValue();
+    else if (arg == "--min-block")
+      options.minBlockSize = value.getIntValue();
+    else if (arg == "--max-block")
+      options.maxBlockSize = value.getIntValue();
+    else if (arg == "--seed")
+      options.seed = value.getLargeIntValue();
+    else if (arg == "--budget")
+      options.budgetPercent = value.getDoubleValue();
+    else if (arg == "--rates")
+    {
+      options.sampleRates.clear();
+
+      for (const auto& rate : juce::StringArray::fromTokens (value, ",", {}))
+        options.sampleRates.add (rate.getDoubleValue());
+    }
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.secondsPerRate <= 0.0)
+    return "--seconds must be positive";
+
+  if (options.sampleRates.isEmpty())
+    return "--rates needs at least one rate";
+
+  for (const auto rate : options.sampleRates)
+    if (rate < 8000.0 || rate > 768000.0)
+      return "every rate must be between 8000 and 768000";
+
+  if (options.numChannels < 1 || options.numChannels > 64)
+    return "--channels must be between 1 and 64";
+
+  if (options.minBlockSize < 1 || options.maxBlockSize < options.minBlockSize || options.maxBlockSize > 1 << 16)
+    return "block sizes must satisfy 1 <= --min-block <= --max-block <= 65536";
+
+  if (options.budgetPercent < 0.0)
+    return "--budget cannot be negative";
+
+  return {};
+}
+
+int run (const Options& options)
+{
+  std::unique_ptr<juce::AudioProcessor> processor (createPluginFilter());
+  processor->setPlayConfigDetails (options.numChannels, options.numChannels,
+                                   options.sampleRates.getFirst(), options.maxBlockSize);
+
+  if (processor->getTotalNumInputChannels() != options.numChannels
+      || processor->getTotalNumOutputChannels() != options.numChannels)
+  {
+    std::cerr << "EQ5b: cannot process " << options.numChannels << " channels" << std::endl;
+    return 1;
+  }
+
+  AudioLoop audio (*processor, options);
+  RateChanges rates (*processor, audio, options);
+  Automation automation (*processor, options.seed + 1);
+
+  {
+    StateChanges stateChanges (*processor, rates, options.seed + 2);
+
+    audio.startThread (juce::Thread::Priority::highest);
+    automation.startThread (juce::Thread::Priority::normal);
+    rates.startThread (juce::Thread::Priority::normal);
+
+    // The processor's async updates are delivered while the loop runs.
+    juce::MessageManager::getInstance()->runDispatchLoop();
+  }
+
+  automation.stopThread (1000);
+  audio.stopThread (10000);
+
+  auto worstLoad = 0.f;
+
+  for (int i = 0; i < options.sampleRates.size(); ++i)
+    worstLoad = juce::jmax (worstLoad, report (options.sampleRates[i], audio.getTimings (i)));
+
+  if (options.budgetPercent > 0.0 && 100.0 * worstLoad > options.budgetPercent)
+  {
+    std::cout << "over budget: worst block at " << juce::String (100.0 * worstLoad, 2)
+              << "% of real time, budget " << options.budgetPercent << "%" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+}
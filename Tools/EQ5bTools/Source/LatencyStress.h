@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    LatencyStress.h
+    EQ5bTools mode that measures the tail of the per-block execution time
+    while parameters, states and sample rates change underneath the processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Run by the EQ5bTools console program when the command line contains
+    --stress:
+
+        EQ5bTools --stress [--seconds S] [--rates HZ,HZ,...] [--channels N]
+                           [--min-block FRAMES] [--max-block FRAMES] [--seed N]
+                           [--budget PERCENT]
+
+    An audio thread runs blocks of random sizes back to back on noise, while
+    a thread of its own prepares the processor for each rate in turn and
+    leaves it running for the given number of seconds; the audio thread only
+    pauses around each prepare. Meanwhile an automation thread sets a random
+    parameter to a random value about every millisecond, and the calling
+    thread runs the message loop, so the processor's async updates arrive,
+    with a timer that saves and restores whole states every 20 ms.
+
+    Each block's execution time is taken relative to the real time the block
+    represents. One line per rate reports the percentiles of that load, the
+    jitter between the median and the 99.9th percentile, and the slowest block.
+    With a budget, the run fails if any block took longer than that percentage
+    of its real time, so a release can be gated on its worst case rather than
+    on its average.
+*/
+namespace LatencyStress
+{
+  struct Options
+  {
+    double secondsPerRate = 5.0;
+    juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0 };
+    int numChannels = 2;
+    int minBlockSize = 16;
+    int maxBlockSize = 1024;
+    juce::int64 seed = 1;
+    double budgetPercent = 0.0;  // no gate
+  };
+
+  bool isRequested (const juce::String& commandLine);
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Runs every rate and returns the process exit code: 1 if a block went over
+      the budget or the processor could not be set up.
+  */
+  int run (const Options& options);
+}
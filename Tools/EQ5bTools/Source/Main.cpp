@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Console program for the engine's checks and measurements, which run
+    against the plugin's sources rather than inside the plugin; each mode's
+    header has its command line.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "EngineCheck.h"
+#include "FormBenchmark.h"
+#include "HeadlessStream.h"
+#include "InstanceFootprint.h"
+#include "LatencyStress.h"
+#include "ParameterSweep.h"
+#include <iostream>
+
+namespace
+{
+  /** Parses the command line for one mode and runs it; returns 2 if the
+      command line was wrong.
+  */
+  template <typename Options, typename Parse, typename Run>
+  int runMode (const juce::String& commandLine, Parse parseCommandLine, Run run)
+  {
+    Options options;
+    const auto error = parseCommandLine (commandLine, options);
+
+    if (error.isNotEmpty())
+    {
+      std::cerr << "EQ5bTools: " << error << std::endl;
+      return 2;
+    }
+
+    return run (options);
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  // The processors the modes create expect a message thread.
+  const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  juce::StringArray args;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const auto arg = juce::String::fromUTF8 (argv[i]);
+    args.add (arg.containsChar (' ') ? arg.quoted() : arg);
+  }
+
+  const auto commandLine = args.joinIntoString (" ");
+
+  if (EngineCheck::isRequested (commandLine))
+    return runMode<EngineCheck::Options> (commandLine, EngineCheck::parseCommandLine, EngineCheck::run);
+
+  if (LatencyStress::isRequested (commandLine))
+    return runMode<LatencyStress::Options> (commandLine, LatencyStress::parseCommandLine, LatencyStress::run);
+
+  if (InstanceFootprint::isRequested (commandLine))
+    return runMode<InstanceFootprint::Options> (commandLine, InstanceFootprint::parseCommandLine, InstanceFootprint::run);
+
+  if (ParameterSweep::isRequested (commandLine))
+    return runMode<ParameterSweep::Options> (commandLine, ParameterSweep::parseCommandLine, ParameterSweep::run);
+
+  if (FormBenchmark::isRequested (commandLine))
+    return runMode<FormBenchmark::Options> (commandLine, FormBenchmark::parseCommandLine, FormBenchmark::run);
+
+  if (HeadlessStream::isRequested (commandLine))
+    return runMode<HeadlessStream::Options> (commandLine, HeadlessStream::parseCommandLine, HeadlessStream::run);
+
+  std::cerr << "EQ5bTools: pass one of --engine-check, --stress, --footprint, --sweep, --forms or --headless" << std::endl;
+  return 2;
+}
@@ -0,0 +1,594 @@
+/*
+  ==============================================================================
+
+    ParameterSweep.cpp
+    EQ5bTools mode that designs every filter on a grid over the parameter
+    ranges at each sample rate, on all cores, and checks each design.
+
+  ==============================================================================
+*/
+
+#include "ParameterSweep.h"
+#include "PluginProcessor.h"
+#include <iostream>
+
+namespace ParameterSweep
+{
+namespace
+{
+  constexpr double conditioningToleranceDb = 0.1;
+  constexpr double floorDb = -60.0;
+  constexpr int numFrequencies = 128;
+
+  enum class Family
+  {
+    peak,
+    highPass,
+    lowPass
+  };
+
+  /** Where the designs of one rate are checked: log-spaced from 20 Hz to
+      20 kHz or just below Nyquist, whichever is lower.
+  */
+  struct FrequencyGrid
+  {
+    explicit FrequencyGrid (double rate) : sampleRate (rate)
+    {
+      const auto top = juce::jmin (20000.0, 0.99 * 0.5 * rate);
+
+      for (size_t i = 0; i < hz.size(); ++i)
+      {
+        hz[i] = 20.0 * std::pow (top / 20.0, (double) i / (double) (hz.size() - 1));
+        const auto s = std::sin (juce::MathConstants<double>::pi * hz[i] / rate);
+        phi[i] = s * s;
+      }
+    }
+
+    double sampleRate;
+    std::array<double, numFrequencies> hz {}, phi {};
+  };
+
+  struct Point
+  {
+    float gain = 0, freq = 0, q = 0;
+    Slope slope = slope_12;
+  };
+
+  /** One family and design at one rate. A row is one gain and frequency of a
+      peak across every Q, or one slope of a cut across every frequency.
+  */
+  struct Group
+  {
+    juce::String name;
+    Family family = Family::peak;
+    Design design = design_bilinear;
+    int rateIndex = 0;
+    std::vector<float> gains, freqs, qs;  // cuts only use freqs
+
+    int getNumRows() const  { return family == Family::peak ? (int) (gains.size() * freqs.size()) : numCutStages; }
+    int getRowSize() const  { return (int) (family == Family::peak ? qs.size() : freqs.size()); }
+
+    Point getPoint (int row, int column) const
+    {
+      if (family == Family::peak)
+        return { gains[(size_t) row / freqs.size()], freqs[(size_t) row % freqs.size()], qs[(size_t) column] };
+
+      return { 0.f, freqs[(size_t) column], 0.f, static_cast<Slope> (row) };
+    }
+
+    juce::String describe (const Point& point) const
+    {
+      if (family == Family::peak)
+        return juce::String (point.freq, 0) + " Hz, Q " + juce::String (point.q, 2) + ", "
+               + juce::String (point.gain, 1) + " dB";
+
+      return juce::String (point.freq, 0) + " Hz, " + juce::String (12 * (point.slope + 1)) + " dB/oct";
+    }
+  };
+
+  /** Squared magnitude of b0 + b1 z^-1 + b2 z^-2 at phi = sin^2 (w / 2), as in
+      MagnitudeResponse.h but in double.
+  */
+  double getSquaredMagnitude (double b0, double b1, double b2, double phi)
+  {
+    const auto sum = b0 + b1 + b2;
+    return sum * sum - 4.0 * phi * (b1 * (b0 + b2) + 4.0 * b0 * b2) + 16.0 * b0 * b2 * phi * phi;
+  }
+
+  /** The analog peak, or the Butterworth cut of the slope's order, that the
+      design stands for.
+  */
+  double getAnalogSquaredMagnitude (const Group& group, const Point& point, double hz)
+  {
+    if (group.family == Family::peak)
+    {
+      const auto a = juce::Decibels::decibelsToGain ((double) point.gain / 2.0);
+      const auto x = hz / (double) point.freq;
+      const auto d = (1.0 - x * x) * (1.0 - x * x);
+      const auto num = d + juce::square (a * x / (double) point.q);
+      const auto den = d + juce::square (x / (a * (double) point.q));
+      return num / den;
+    }
+
+    const auto order = 2 * (point.slope + 1);
+    const auto ratio = group.family == Family::lowPass ? hz / (double) point.freq : (double) point.freq / hz;
+    return 1.0 / (1.0 + std::pow (ratio, 2.0 * order));
+  }
+
+  int designFilter (const Group& group, const Point& point, double sampleRate, BiquadCoefficients* sections)
+  {
+    if (group.family == Family::peak)
+    {
+      ChainSettings::PeakFilter filter;
+      filter.gain = point.gain;
+      filter.freq = point.freq;
+      filter.q = point.q;
+      filter.design = group.design;
+
+      sections[0] = makePeakFilter (filter, sampleRate).toFloat();
+      return 1;
+    }
+
+    ChainSettings::CutFilter filter;
+    filter.cutf = point.freq;
+    filter.slope = point.slope;
+    filter.design = group.design;
+
+    std::array<PreciseBiquadCoefficients, numCutStages> designed;
+    const auto numSections = makeCutFilter (filter, sampleRate, group.family == Family::highPass, designed.data());
+
+    for (int s = 0; s < numSections; ++s)
+      sections[s] = designed[(size_t) s].toFloat();
+
+    return numSections;
+  }
+
+  bool isStable (const BiquadCoefficients& c)
+  {
+    for (const auto value : { c.b0, c.b1, c.b2, c.a1, c.a2 })
+      if (! std::isfinite (value))
+        return false;
+
+    // The stability triangle of z^2 + a1 z + a2.
+    return std::abs (c.a2) < 1.f && std::abs (c.a1) < 1.f + c.a2;
+  }
+
+  float getNextAwayFromZero (float value)
+  {
+    return std::nextafter (value, value < 0 ? -std::numeric_limits<float>::infinity()
+                                            : std::numeric_limits<float>::infinity());
+  }
+
+  struct Finding
+  {
+    const char* problem = "";
+    double db = 0;
+    int groupIndex = -1;
+    Point point;
+    double hz = 0;
+  };
+
+  struct Tally
+  {
+    int designs = 0, unstable = 0, illConditioned = 0, warped = 0, precise = 0;
+    Finding worstWarp, worstConditioning;
+    double seconds = 0, worstRowSeconds = 0;  // per design
+
+    void add (const Tally& other)
+    {
+      designs += other.designs;
+      unstable += other.unstable;
+      illConditioned += other.illConditioned;
+      warped += other.warped;
+      precise += other.precise;
+      seconds += other.seconds;
+      worstRowSeconds = juce::jmax (worstRowSeconds, other.worstRowSeconds);
+
+      if (other.worstWarp.db > worstWarp.db)
+        worstWarp = other.worstWarp;
+
+      if (other.worstConditioning.db > worstConditioning.db)
+        worstConditioning = other.worstConditioning;
+    }
+  };
+
+  /** Keeps the numListed most severe findings, unstable ones first. */
+  void addFinding (std::vector<Finding>& findings, const Finding& finding, int numListed)
+  {
+    findings.push_back (finding);
+    std::sort (findings.begin(), findings.end(), [] (const auto& a, const auto& b) { return a.db > b.db; });
+
+    if ((int) findings.size() > numListed)
+      findings.resize ((size_t) numListed);
+  }
+
+  void checkDesign (const Group& group, int groupIndex, const Point& point,
+                    const BiquadCoefficients* sections, int numSections,
+                    const FrequencyGrid& grid, const Options& options,
+                    Tally& tally, std::vector<Finding>& findings)
+  {
+    ++tally.designs;
+
+    if (std::any_of (sections, sections + numSections, [] (const auto& c) { return needsDoublePrecision (c); }))
+      ++tally.precise;
+
+    if (! std::all_of (sections, sections + numSections, isStable))
+    {
+      ++tally.unstable;
+      addFinding (findings, { "unstable", std::numeric_limits<double>::infinity(), groupIndex, point, 0.0 },
+                  options.numListed);
+      return;
+    }
+
+    Finding warp { "warped", 0.0, groupIndex, point, 0.0 };
+    Finding conditioning { "ill-conditioned", 0.0, groupIndex, point, 0.0 };
+
+    for (size_t i = 0; i < grid.hz.size(); ++i)
+    {
+      const auto phi = grid.phi[i];
+      auto digital = 1.0, sensitivityDb = 0.0;
+
+      for (int s = 0; s < numSections; ++s)
+      {
+        const auto& c = sections[s];
+        const auto den = getSquaredMagnitude (1.0, c.a1, c.a2, phi);
+        digital *= getSquaredMagnitude (c.b0, c.b1, c.b2, phi) / den;
+
+        // Sections are independent, so the worst case adds the shifts up.
+        sensitivityDb += std::abs (10.0 * std::log10 (getSquaredMagnitude (1.0, getNextAwayFromZero (c.a1), c.a2, phi) / den));
+        sensitivityDb += std::abs (10.0 * std::log10 (getSquaredMagnitude (1.0, c.a1, getNextAwayFromZero (c.a2), phi) / den));
+      }
+
+      const auto analog = getAnalogSquaredMagnitude (group, point, grid.hz[i]);
+      const auto errorDb = std::abs (juce::jmax (floorDb, 10.0 * std::log10 (digital))
+                                     - juce::jmax (floorDb, 10.0 * std::log10 (analog)));
+
+      if (errorDb > warp.db)
+      {
+        warp.db = errorDb;
+        warp.hz = grid.hz[i];
+      }
+
+      if (sensitivityDb > conditioning.db)
+      {
+        conditioning.db = sensitivityDb;
+        conditioning.hz = grid.hz[i];
+      }
+    }
+
+    if (warp.db > options.toleranceDb)
+    {
+      ++tally.warped;
+      addFinding (findings, warp, options.numListed);
+    }
+
+    if (conditioning.db > conditioningToleranceDb)
+      ++tally.illConditioned;
+
+    if (warp.db > tally.worstWarp.db)
+      tally.worstWarp = warp;
+
+    if (conditioning.db > tally.worstConditioning.db)
+      tally.worstConditioning = conditioning;
+  }
+
+  struct Job
+  {
+    int groupIndex, row;
+  };
+
+  struct JobResult
+  {
+    Tally tally;
+    std::vector<Finding> findings;
+  };
+
+  /** Everything the threads share. Each job writes only its own result, and
+      the next job is taken from an atomic index, so nothing is locked.
+  */
+  struct Sweep
+  {
+    const Options& options;
+    std::vector<FrequencyGrid> grids;
+    std::vector<Group> groups;
+    std::vector<Job> jobs;
+    std::vector<JobResult> results;
+    std::atomic<size_t> nextJob { 0 };
+
+    void runJobs()
+    {
+      std::vector<BiquadCoefficients> sections;
+      std::vector<int> numSections;
+
+      for (auto index = nextJob.fetch_add (1); index < jobs.size(); index = nextJob.fetch_add (1))
+      {
+        const auto& job = jobs[index];
+        const auto& group = groups[(size_t) job.groupIndex];
+        const auto& grid = grids[(size_t) group.rateIndex];
+        auto& result = results[index];
+
+        const auto rowSize = group.getRowSize();
+        sections.resize ((size_t) (rowSize * numCutStages));
+        numSections.resize ((size_t) rowSize);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        for (int column = 0; column < rowSize; ++column)
+          numSections[(size_t) column] = designFilter (group, group.getPoint (job.row, column), grid.sampleRate,
+                                                       &sections[(size_t) (column * numCutStages)]);
+
+        const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        for (int column = 0; column < rowSize; ++column)
+          checkDesign (group, job.groupIndex, group.getPoint (job.row, column),
+                       &sections[(size_t) (column * numCutStages)], numSections[(size_t) column],
+                       grid, options, result.tally, result.findings);
+
+        result.tally.seconds = seconds;
+        result.tally.worstRowSeconds = seconds / rowSize;
+      }
+    }
+  };
+
+  class Worker : public juce::Thread
+  {
+  public:
+    explicit Worker (Sweep& sweepToRun) : juce::Thread ("EQ5b sweep worker"), sweep (sweepToRun) {}
+
+    ~Worker() override
+    {
+      stopThread (-1);
+    }
+
+  private:
+    void run() override
+    {
+      sweep.runJobs();
+    }
+
+    Sweep& sweep;
+
+    JUCE_DECLARE_NON_COPYABLE (Worker)
+  };
+
+  /** Values of the parameter at steps evenly spaced normalised positions. */
+  std::vector<float> getGridValues (juce::AudioProcessorValueTreeState& state, const juce::String& parameterID, int steps)
+  {
+    const auto& range = state.getParameter (parameterID)->getNormalisableRange();
+    std::vector<float> values;
+
+    for (int i = 0; i < steps; ++i)
+      values.push_back (range.convertFrom0to1 ((float) i / (float) (steps - 1)));
+
+    return values;
+  }
+
+  /** One group per rate, design and family; peak bands whose ranges are the
+      same share a group.
+  */
+  std::vector<Group> makeGroups (const Options& options)
+  {
+    EQ5bAudioProcessor processor;
+    auto& state = processor.processorParameters;
+    const auto& ids = getChannelParameterIDs();
+
+    std::vector<Group> peakRanges;
+    int firstBand = 1;
+
+    for (int band = 1; band <= maxPeakBands; ++band)
+    {
+      const auto& peakIDs = ids.peaks[size_t (band - 1)];
+
+      Group range;
+      range.gains = getGridValues (state, peakIDs.gain, options.steps);
+      range.freqs = getGridValues (state, peakIDs.freq, options.steps);
+      range.qs = getGridValues (state, peakIDs.q, options.steps);
+
+      if (! peakRanges.empty() && range.gains == peakRanges.back().gains
+          && range.freqs == peakRanges.back().freqs && range.qs == peakRanges.back().qs)
+      {
+        peakRanges.back().name = "peak " + juce::String (firstBand) + "-" + juce::String (band);
+        continue;
+      }
+
+      range.name = "peak " + juce::String (band);
+      peakRanges.push_back (std::move (range));
+      firstBand = band;
+    }
+
+    Group highPass, lowPass;
+    highPass.name = "high-pass";
+    highPass.family = Family::highPass;
+    highPass.freqs = getGridValues (state, ids.hpFreq, options.steps);
+    lowPass.name = "low-pass";
+    lowPass.family = Family::lowPass;
+    lowPass.freqs = getGridValues (state, ids.lpFreq, options.steps);
+
+    std::vector<Group> groups;
+
+    for (int rateIndex = 0; rateIndex < options.sampleRates.size(); ++rateIndex)
+    {
+      for (const auto design : { design_bilinear, design_matched })
+      {
+        auto add = [&] (Group group)
+        {
+          group.name << (design == design_matched ? " matched" : " bilinear");
+          group.design = design;
+          group.rateIndex = rateIndex;
+          groups.push_back (std::move (group));
+        };
+
+        for (const auto& range : peakRanges)
+          add (range);
+
+        add (highPass);
+        add (lowPass);
+      }
+    }
+
+    return groups;
+  }
+
+  juce::String formatFinding (const Finding& finding)
+  {
+    return juce::String (finding.db, 2) + " dB at " + juce::String (finding.hz, 0) + " Hz";
+  }
+
+  void report (const Group& group, double sampleRate, const Tally& tally)
+  {
+    std::cout << sampleRate << " Hz, " << group.name << ": "
+              << tally.designs << " designs, "
+              << tally.unstable << " unstable, "
+              << tally.illConditioned << " ill-conditioned";
+
+    if (tally.worstConditioning.groupIndex >= 0)
+      std::cout << " (worst " << formatFinding (tally.worstConditioning) << " for "
+                << group.describe (tally.worstConditioning.point) << ")";
+
+    std::cout << ", " << tally.warped << " warped";
+
+    if (tally.worstWarp.groupIndex >= 0)
+      std::cout << " (worst " << formatFinding (tally.worstWarp) << " for "
+                << group.describe (tally.worstWarp.point) << ")";
+
+    std::cout << ", " << tally.precise << " in double precision, "
+              << juce::String (tally.seconds * 1.0e9 / juce::jmax (1, tally.designs), 1) << " ns per design"
+              << " (worst row " << juce::String (tally.worstRowSeconds * 1.0e9, 1) << " ns)" << std::endl;
+  }
+}
+
+//==============================================================================
+bool isRequested (const juce::String& commandLine)
+{
+  return juce::StringArray::fromTokens (commandLine, true).contains ("--sweep");
+}
+
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (arg == "--sweep")
+      continue;
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--steps")
+      options.steps = value.getIntValue();
+    else if (arg == "--threads")
+      options.numThreads = value.getIntValue();
+    else if (arg == "--tolerance")
+      options.toleranceDb = value.getDoubleValue();
+    else if (arg == "--list")
+      options.numListed = value.getIntValue();
+    else if (arg == "--rates")
+    {
+      options.sampleRates.clear();
+
+      for (const auto& rate : juce::StringArray::fromTokens (value, ",", {}))
+        options.sampleRates.add (rate.getDoubleValue());
+    }
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.sampleRates.isEmpty())
+    return "--rates needs at least one rate";
+
+  for (const auto rate : options.sampleRates)
+    if (rate < 8000.0 || rate > 768000.0)
+      return "every rate must be between 8000 and 768000";
+
+  if (options.steps < 2 || options.steps > 256)
+    return "--steps must be between 2 and 256";
+
+  if (options.numThreads < 0 || options.numThreads > 1024)
+    return "--threads must be between 0 and 1024";
+
+  if (options.toleranceDb <= 0.0)
+    return "--tolerance must be positive";
+
+  if (options.numListed < 0)
+    return "--list cannot be negative";
+
+  return {};
+}
+
+int run (const Options& options)
+{
+  Sweep sweep { options };
+
+  for (const auto rate : options.sampleRates)
+    sweep.grids.emplace_back (rate);
+
+  sweep.groups = makeGroups (options);
+
+  for (int groupIndex = 0; groupIndex < (int) sweep.groups.size(); ++groupIndex)
+    for (int row = 0; row < sweep.groups[(size_t) groupIndex].getNumRows(); ++row)
+      sweep.jobs.push_back ({ groupIndex, row });
+
+  sweep.results.resize (sweep.jobs.size());
+
+  const auto numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+  const auto start = juce::Time::getMillisecondCounterHiRes();
+
+  {
+    juce::OwnedArray<Worker> workers;
+
+    for (int i = 1; i < numThreads; ++i)
+      workers.add (new Worker (sweep))->startThread();
+
+    sweep.runJobs();
+  }
+
+  const auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+  std::vector<Tally> tallies (sweep.groups.size());
+  std::vector<Finding> findings;
+  Tally total;
+
+  for (size_t i = 0; i < sweep.jobs.size(); ++i)
+  {
+    tallies[(size_t) sweep.jobs[i].groupIndex].add (sweep.results[i].tally);
+
+    for (const auto& finding : sweep.results[i].findings)
+      addFinding (findings, finding, options.numListed);
+  }
+
+  for (size_t i = 0; i < sweep.groups.size(); ++i)
+  {
+    const auto& group = sweep.groups[i];
+    report (group, options.sampleRates[group.rateIndex], tallies[i]);
+    total.add (tallies[i]);
+  }
+
+  if (! findings.empty())
+  {
+    std::cout << "worst designs:" << std::endl;
+
+    for (const auto& finding : findings)
+    {
+      const auto& group = sweep.groups[(size_t) finding.groupIndex];
+      std::cout << "  " << finding.problem;
+
+      if (std::isfinite (finding.db))
+        std::cout << " by " << formatFinding (finding);
+
+      std::cout << ": " << options.sampleRates[group.rateIndex] << " Hz, " << group.name << ", "
+                << group.describe (finding.point) << std::endl;
+    }
+  }
+
+  std::cout << total.designs << " designs on " << numThreads << " threads in " << juce::String (seconds, 2) << " s: "
+            << total.unstable << " unstable, " << total.illConditioned << " ill-conditioned, "
+            << total.warped << " warped" << std::endl;
+
+  return total.unstable > 0 ? 1 : 0;
+}
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    ParameterSweep.h
+    EQ5bTools mode that designs every filter on a grid over the parameter
+    ranges at each sample rate, on all cores, and checks each design.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Run by the EQ5bTools console program when the command line contains
+    --sweep:
+
+        EQ5bTools --sweep [--rates HZ,HZ,...] [--steps N] [--threads N]
+                          [--tolerance DB] [--list N]
+
+    The grid takes steps values of each parameter a design depends on, evenly
+    spaced in the parameter's normalised range, so the skew and the extremes
+    of createParameterLayout are honoured: gain, frequency and Q of each
+    distinct peak range, every slope and frequency of the cuts, and both
+    filter designs. Every point is designed with makePeakFilter or
+    makeCutFilter at every rate and checked for being
+
+      - unstable: a coefficient that is not finite or a pole on or outside
+        the unit circle,
+      - ill-conditioned: moving a1 or a2 of any section by one float ulp
+        changes the response by more than 0.1 dB somewhere,
+      - warped: the magnitude differs from the analog prototype by more than
+        the tolerance between 20 Hz and 20 kHz or just below Nyquist, with
+        both floored at -60 dB.
+
+    Sections that FilterCascade will run in double precision are counted too.
+
+    One line per rate and design family gives the counts, the worst warp and
+    conditioning with the parameters that caused them, and the design time
+    per filter, taken over each row of the grid. The threads share the cores,
+    so the times are for comparison between families rather than absolute.
+    The worst flagged designs are listed after that.
+*/
+namespace ParameterSweep
+{
+  struct Options
+  {
+    juce::Array<double> sampleRates { 32000.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    int steps = 16;
+    int numThreads = 0;          // one per core
+    double toleranceDb = 1.0;
+    int numListed = 10;
+  };
+
+  bool isRequested (const juce::String& commandLine);
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Sweeps every rate and returns the process exit code: 1 if any design is
+      unstable.
+  */
+  int run (const Options& options);
+}
@@ -0,0 +1,309 @@
+/*
+  ==============================================================================
+
+    LV2Benchmark.cpp
+    Loads the built LV2 bundle as a host would and times its instantiation,
+    its run() calls and its state against the processor called directly.
+
+  ==============================================================================
+*/
+
+#include "LV2Benchmark.h"
+#include "JuceLV2Defines.h"
+#include <cstdlib>
+#include <iostream>
+
+// With useAppConfig off, the module options in EQ5bLV2Host.jucer reach the
+// compiler through the exporter's build files.
+#if ! JUCE_PLUGINHOST_LV2
+ #error "JUCE_PLUGINHOST_LV2 is not set: re-save EQ5bLV2Host.jucer in the Projucer"
+#endif
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+
+namespace LV2Benchmark
+{
+namespace
+{
+  constexpr int warmUpCalls = 100;
+
+  using Factory = std::function<std::unique_ptr<juce::AudioProcessor>()>;
+
+  double getSeconds (juce::int64 startTicks)
+  {
+    return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+  }
+
+  juce::String formatMicroseconds (double seconds)
+  {
+    return juce::String (seconds * 1.0e6, 2) + " us";
+  }
+
+  void report (const juce::String& what, double hosted, double direct, const juce::String& extra = {})
+  {
+    std::cout << what << ": lv2 " << formatMicroseconds (hosted) << ", direct " << formatMicroseconds (direct)
+              << ", overhead " << formatMicroseconds (hosted - direct) << extra << std::endl;
+  }
+
+  struct Instantiation
+  {
+    double createSeconds = 0, prepareSeconds = 0;  // per instance
+  };
+
+  /** Creates and then prepares numInstances instances; false if any fails. */
+  bool instantiate (const Factory& create, int numInputs, int numOutputs, const Options& options,
+                    int maxBlockSize, Instantiation& result)
+  {
+    std::vector<std::unique_ptr<juce::AudioProcessor>> instances;
+    const auto createStart = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < options.numInstances; ++i)
+    {
+      instances.push_back (create());
+
+      if (instances.back() == nullptr)
+        return false;
+    }
+
+    result.createSeconds = getSeconds (createStart) / options.numInstances;
+
+    const auto prepareStart = juce::Time::getHighResolutionTicks();
+
+    for (auto& instance : instances)
+    {
+      instance->setPlayConfigDetails (numInputs, numOutputs, options.sampleRate, maxBlockSize);
+      instance->prepareToPlay (options.sampleRate, maxBlockSize);
+    }
+
+    result.prepareSeconds = getSeconds (prepareStart) / options.numInstances;
+    return true;
+  }
+
+  struct CallTimes
+  {
+    double median = 0, p99 = 0;
+  };
+
+  /** Times each of numCalls blocks of noise after a warm-up. The buffer is
+      refilled between calls, outside the timing, so every call sees the same
+      input.
+  */
+  CallTimes timeCalls (juce::AudioProcessor& processor, const juce::AudioBuffer<float>& noise,
+                       juce::AudioBuffer<float>& buffer, int numCalls, std::vector<double>& seconds)
+  {
+    juce::MidiBuffer midi;
+    seconds.resize ((size_t) numCalls);
+
+    for (int call = -warmUpCalls; call < numCalls; ++call)
+    {
+      for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        buffer.copyFrom (ch, 0, noise, ch, 0, buffer.getNumSamples());
+
+      midi.clear();
+
+      const auto start = juce::Time::getHighResolutionTicks();
+      processor.processBlock (buffer, midi);
+      const auto elapsed = getSeconds (start);
+
+      if (call >= 0)
+        seconds[(size_t) call] = elapsed;
+    }
+
+    std::sort (seconds.begin(), seconds.end());
+    return { seconds[seconds.size() / 2], seconds[juce::jmin (seconds.size() - 1, (size_t) (0.99 * (double) seconds.size()))] };
+  }
+
+  /** Per save, with the last state saved left in state. */
+  double timeSaves (juce::AudioProcessor& processor, juce::MemoryBlock& state, int rounds)
+  {
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < rounds; ++i)
+    {
+      state.reset();
+      processor.getStateInformation (state);
+    }
+
+    return getSeconds (start) / rounds;
+  }
+
+  double timeRestores (juce::AudioProcessor& processor, const juce::MemoryBlock& state, int rounds)
+  {
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < rounds; ++i)
+      processor.setStateInformation (state.getData(), (int) state.getSize());
+
+    return getSeconds (start) / rounds;
+  }
+}
+
+//==============================================================================
+juce::String parseCommandLine (const juce::String& commandLine, Options& options)
+{
+  const auto args = juce::StringArray::fromTokens (commandLine, true);
+
+  for (int i = 0; i < args.size(); ++i)
+  {
+    const auto& arg = args[i];
+
+    if (i + 1 >= args.size())
+      return "missing value for " + arg;
+
+    const auto value = args[++i].unquoted();
+
+    if (arg == "--bundle")
+      options.bundle = juce::File::getCurrentWorkingDirectory().getChildFile (value);
+    else if (arg == "--uri")
+      options.uri = value;
+    else if (arg == "--rate")
+      options.sampleRate = value.getDoubleValue();
+    else if (arg == "--calls")
+      options.numCalls = value.getIntValue();
+    else if (arg == "--instances")
+      options.numInstances = value.getIntValue();
+    else if (arg == "--states")
+      options.numStateRounds = value.getIntValue();
+    else if (arg == "--blocks")
+    {
+      options.blockSizes.clear();
+
+      for (const auto& size : juce::StringArray::fromTokens (value, ",", {}))
+        options.blockSizes.add (size.getIntValue());
+    }
+    else
+      return "unknown option " + arg;
+  }
+
+  if (options.sampleRate < 8000.0 || options.sampleRate > 768000.0)
+    return "--rate must be between 8000 and 768000";
+
+  if (options.blockSizes.isEmpty())
+    return "--blocks needs at least one size";
+
+  for (const auto size : options.blockSizes)
+    if (size < 1 || size > 1 << 16)
+      return "every block size must be between 1 and 65536";
+
+  if (options.numCalls < 1 || options.numInstances < 1 || options.numStateRounds < 1)
+    return "--calls, --instances and --states must be positive";
+
+  return {};
+}
+
+int run (const Options& options)
+{
+  const auto bundle = options.bundle != juce::File() ? options.bundle
+                                                     : juce::File::getSpecialLocation (juce::File::currentExecutableFile)
+                                                         .getSiblingFile ("EQ5b.lv2");
+  const auto uri = options.uri.isNotEmpty() ? options.uri : juce::String (JucePlugin_LV2URI);
+
+  if (! bundle.isDirectory())
+  {
+    std::cerr << "EQ5bLV2Host: no LV2 bundle at " << bundle.getFullPathName() << std::endl;
+    return 1;
+  }
+
+  const auto searchPath = bundle.getParentDirectory().getFullPathName();
+
+ #if ! JUCE_WINDOWS
+  // lilv also loads whatever LV2_PATH lists, where an installed copy of the
+  // plugin would have the same URI as the bundle under test.
+  setenv ("LV2_PATH", searchPath.toRawUTF8(), 1);
+ #endif
+
+  juce::LV2PluginFormat format;
+  format.searchPathsForPlugins (juce::FileSearchPath (searchPath), false, false);
+
+  juce::OwnedArray<juce::PluginDescription> types;
+  format.findAllTypesForFile (types, uri);
+
+  if (types.isEmpty())
+  {
+    std::cerr << "EQ5bLV2Host: " << uri << " not found in " << searchPath << std::endl;
+    return 1;
+  }
+
+  const auto description = *types.getFirst();
+  const auto maxBlockSize = *std::max_element (options.blockSizes.begin(), options.blockSizes.end());
+
+  const Factory createHosted = [&]() -> std::unique_ptr<juce::AudioProcessor>
+  {
+    juce::String error;
+    auto instance = format.createInstanceFromDescription (description, options.sampleRate, maxBlockSize, error);
+
+    if (instance == nullptr)
+      std::cerr << "EQ5bLV2Host: cannot instantiate " << uri << ": " << error << std::endl;
+
+    return instance;
+  };
+
+  const Factory createDirect = [] { return std::unique_ptr<juce::AudioProcessor> (createPluginFilter()); };
+
+  // The first instance of each also loads what instances share, such as the
+  // plugin binary and the kernel table; it is kept for the later figures.
+  auto hosted = createHosted();
+  auto direct = createDirect();
+
+  if (hosted == nullptr)
+    return 1;
+
+  const auto numInputs = hosted->getTotalNumInputChannels();
+  const auto numOutputs = hosted->getTotalNumOutputChannels();
+  const auto numChannels = juce::jmax (numInputs, numOutputs);
+
+  std::cout << description.name << " from " << bundle.getFullPathName() << ", "
+            << numInputs << " in, " << numOutputs << " out, " << options.sampleRate << " Hz" << std::endl;
+
+  Instantiation hostedInstantiation, directInstantiation;
+
+  if (! instantiate (createHosted, numInputs, numOutputs, options, maxBlockSize, hostedInstantiation)
+      || ! instantiate (createDirect, numInputs, numOutputs, options, maxBlockSize, directInstantiation))
+    return 1;
+
+  const auto perInstance = " per instance over " + juce::String (options.numInstances);
+  report ("create", hostedInstantiation.createSeconds, directInstantiation.createSeconds, perInstance);
+  report ("prepare", hostedInstantiation.prepareSeconds, directInstantiation.prepareSeconds, perInstance);
+
+  juce::Random random (1);
+  juce::AudioBuffer<float> noise (numChannels, maxBlockSize);
+  juce::AudioBuffer<float> buffer (numChannels, maxBlockSize);
+  std::vector<double> seconds;
+
+  for (int ch = 0; ch < numChannels; ++ch)
+    for (int i = 0; i < maxBlockSize; ++i)
+      noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+  for (const auto blockSize : options.blockSizes)
+  {
+    buffer.setSize (numChannels, blockSize, false, false, true);
+
+    for (auto* processor : { hosted.get(), direct.get() })
+    {
+      processor->setPlayConfigDetails (numInputs, numOutputs, options.sampleRate, blockSize);
+      processor->prepareToPlay (options.sampleRate, blockSize);
+    }
+
+    const auto hostedTimes = timeCalls (*hosted, noise, buffer, options.numCalls, seconds);
+    const auto directTimes = timeCalls (*direct, noise, buffer, options.numCalls, seconds);
+
+    const auto label = "run " + juce::String (blockSize) + " frames";
+    report (label + " p50", hostedTimes.median, directTimes.median,
+            ", " + juce::String ((hostedTimes.median - directTimes.median) * 1.0e9 / blockSize, 2) + " ns per frame");
+    report (label + " p99", hostedTimes.p99, directTimes.p99);
+  }
+
+  juce::MemoryBlock hostedState, directState;
+  const auto hostedSave = timeSaves (*hosted, hostedState, options.numStateRounds);
+  const auto directSave = timeSaves (*direct, directState, options.numStateRounds);
+
+  report ("save state", hostedSave, directSave,
+          ", " + juce::String ((juce::int64) hostedState.getSize()) + " and "
+          + juce::String ((juce::int64) directState.getSize()) + " bytes");
+
+  report ("restore state", timeRestores (*hosted, hostedState, options.numStateRounds),
+          timeRestores (*direct, directState, options.numStateRounds));
+
+  return 0;
+}
+}
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    LV2Benchmark.h
+    Loads the built LV2 bundle as a host would and times its instantiation,
+    its run() calls and its state against the processor called directly.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** What the EQ5bLV2Host program runs:
+
+        EQ5bLV2Host [--bundle PATH] [--uri URI] [--rate HZ]
+                    [--blocks FRAMES,FRAMES,...] [--calls N]
+                    [--instances N] [--states N]
+
+    The program is built from its own project, with JUCE_PLUGINHOST_LV2, so
+    the plugin carries no hosting code. Its Linux build writes the executable
+    next to the plugin's EQ5b.lv2, where the bundle defaults to. It is loaded through juce::LV2PluginFormat, so the figures
+    cover what any lilv-based host goes through: the plugin's LV2 wrapper with
+    its port, atom and URID handling, and the host side of the same. Every
+    figure is printed next to the same measurement on a processor compiled
+    into this program from the plugin's sources, and the difference is the cost of the deployed artifact over
+    the bare processor.
+
+      - instantiation: creating each of the instances, then preparing them,
+      - run: the median and 99th percentile time of one block of noise, per
+        block size, after a warm-up; the buffers are allocated once and
+        refilled outside the timed calls,
+      - state: saving and restoring the state that many times in turn, with
+        the size of the saved state.
+*/
+namespace LV2Benchmark
+{
+  struct Options
+  {
+    juce::File bundle;           // EQ5b.lv2 next to the executable if not set
+    juce::String uri;            // the project's LV2 URI if empty
+    double sampleRate = 48000.0;
+    juce::Array<int> blockSizes { 32, 128, 512, 2048 };
+    int numCalls = 10000;
+    int numInstances = 20;
+    int numStateRounds = 1000;
+  };
+
+  /** Returns an empty string on success, otherwise what was wrong. */
+  juce::String parseCommandLine (const juce::String& commandLine, Options& options);
+
+  /** Returns the process exit code: 1 if the bundle could not be loaded. */
+  int run (const Options& options);
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Console host that benchmarks the built EQ5b.lv2 bundle; see
+    LV2Benchmark.h for the command line.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "LV2Benchmark.h"
+#include <iostream>
+
+int main (int argc, char* argv[])
+{
+  // Both the hosted and the direct processor expect a message thread.
+  const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  juce::StringArray args;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const auto arg = juce::String::fromUTF8 (argv[i]);
+    args.add (arg.containsChar (' ') ? arg.quoted() : arg);
+  }
+
+  LV2Benchmark::Options options;
+  const auto error = LV2Benchmark::parseCommandLine (args.joinIntoString (" "), options);
+
+  if (error.isNotEmpty())
+  {
+    std::cerr << "EQ5bLV2Host: " << error << std::endl;
+    return 2;
+  }
+
+  return LV2Benchmark::run (options);
+}